@@ -0,0 +1,48 @@
+#if !defined DACHS_CODEGEN_LLVMIR_ABI_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_ABI_HPP_INCLUDED
+
+#include <cstdint>
+
+#include <llvm/IR/Type.h>
+
+#include "dachs/codegen/llvmir/context.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+
+// Note:
+// Calling convention of Dachs functions.
+//   - Aggregates whose size is not greater than two machine words are passed and returned
+//     in registers as first-class aggregate values.
+//   - Larger aggregate return values are written to the storage allocated by the caller.
+//     The pointer to the storage is passed as the first parameter with 'sret'.
+//   - Larger aggregate parameters are passed by pointer with 'readonly' and 'nocapture'.
+//     The callee copies the pointee when it modifies the parameter.
+// "main" function is not affected because it is called from outside.
+namespace abi {
+
+constexpr std::uint64_t max_register_aggregate_size = 16u; // In bytes
+
+inline bool is_passed_in_memory(context const& ctx, llvm::Type *const t)
+{
+    return (t->isStructTy() || t->isArrayTy())
+        && ctx.data_layout->getTypeAllocSize(t) > max_register_aggregate_size;
+}
+
+// Note:
+// Returns true when the function parameter receives a value of 'arg_type' by pointer
+inline bool is_passed_by_pointer(llvm::Type *const param_type, llvm::Type *const arg_type)
+{
+    return param_type->isPointerTy()
+        && param_type->getPointerElementType() == arg_type
+        && (arg_type->isStructTy() || arg_type->isArrayTy());
+}
+
+} // namespace abi
+
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_ABI_HPP_INCLUDED
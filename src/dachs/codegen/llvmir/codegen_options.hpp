@@ -0,0 +1,45 @@
+#if !defined DACHS_CODEGEN_LLVMIR_CODEGEN_OPTIONS_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_CODEGEN_OPTIONS_HPP_INCLUDED
+
+#include <string>
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+
+// Note:
+// Options which change the generated code.  They are specified by command line options.
+struct codegen_options {
+    // Note:
+    // Indices of fixed-size arrays are checked at run time (--bounds-check).
+    // Indices of dynamic arrays are always checked.  Checks of indices which are
+    // provably in bounds are not emitted.
+    bool bounds_check = false;
+
+    // Note:
+    // DWARF debug information is emitted (-g).
+    bool debug_info = false;
+
+    // Note:
+    // Counters of function entries and branches are inserted (--profile-generate).
+    // The instrumented program writes them to the profile at exit.
+    bool profile_generate = false;
+
+    // Note:
+    // Branch weights and hot/cold functions are given by the profile (--profile-use={file}).
+    // Empty if no profile is used.
+    std::string profile_use_file;
+
+    // Note:
+    // CPU name and target features which the code is tuned for (--march={cpu}, --mattr={features}).
+    // "native" means the host CPU and its features.  Empty CPU name means generic CPU.
+    // Features are separated by comma like "+avx2,-sse4a".
+    std::string target_cpu;
+    std::string target_features;
+};
+
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_CODEGEN_OPTIONS_HPP_INCLUDED
@@ -1,15 +1,22 @@
 #if !defined DACHS_CODEGEN_LLVMIR_CONTEXT_HPP_INCLUDED
 #define      DACHS_CODEGEN_LLVMIR_CONTEXT_HPP_INCLUDED
 
+#include <cstddef>
+#include <string>
+
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/ADT/Triple.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/MC/SubtargetFeature.h>
 #include <llvm/IR/DataLayout.h>
 #include <llvm/Target/TargetMachine.h>
 
+#include "dachs/codegen/llvmir/codegen_options.hpp"
 #include "dachs/exception.hpp"
 
 namespace dachs {
@@ -41,6 +48,50 @@ public:
     {}
 };
 
+namespace detail {
+
+inline std::string target_cpu_name(codegen_options const& opts)
+{
+    if (opts.target_cpu == "native") {
+        return llvm::sys::getHostCPUName();
+    }
+    return opts.target_cpu;
+}
+
+// Note:
+// Explicit features (--mattr) override features of the host CPU.
+inline std::string target_feature_string(codegen_options const& opts)
+{
+    llvm::SubtargetFeatures features;
+
+    if (opts.target_cpu == "native") {
+        // Note:
+        // Host features may not be detected on some platforms.  Then features are
+        // derived from the host CPU name by the target.
+        llvm::StringMap<bool> host_features;
+        if (llvm::sys::getHostCPUFeatures(host_features)) {
+            for (auto const& f : host_features) {
+                features.AddFeature(f.getKey(), f.getValue());
+            }
+        }
+    }
+
+    llvm::SmallVector<llvm::StringRef, 8> explicit_features;
+    llvm::StringRef{opts.target_features}.split(explicit_features, ",", -1, false);
+    for (auto const& f : explicit_features) {
+        features.AddFeature(f.trim());
+    }
+
+    return features.getString();
+}
+
+} // namespace detail
+
+struct code_size_stats {
+    std::size_t merged_functions = 0u;
+    std::size_t removed_instructions = 0u;
+};
+
 class context final : private context_base {
 
     std::string tmp_buffer;
@@ -54,6 +105,8 @@ public:
     llvm::DataLayout const* const data_layout;
     llvm::LLVMContext &llvm_context;
     llvm::IRBuilder<> builder;
+    codegen_options const codegen_opts;
+    code_size_stats size_stats;
 
     context(
         llvm::Triple const triple,
@@ -61,7 +114,8 @@ public:
         llvm::TargetOptions options,
         llvm::TargetMachine *const target_machine,
         llvm::DataLayout const* const data_layout,
-        llvm::LLVMContext &llvm_context
+        llvm::LLVMContext &llvm_context,
+        codegen_options const& opts = codegen_options{}
     ) noexcept
         : context_base()
         , triple(triple)
@@ -71,18 +125,20 @@ public:
         , data_layout(data_layout)
         , llvm_context(llvm_context)
         , builder(llvm_context)
+        , codegen_opts(opts)
     {}
 
-    context()
+    explicit context(codegen_options const& opts = codegen_options{})
         : context_base()
         , tmp_buffer()
         , triple(llvm::sys::getDefaultTargetTriple())
         , target(llvm::TargetRegistry::lookupTarget(triple.getTriple(), tmp_buffer))
         , options()
-        , target_machine(target->createTargetMachine(triple.getTriple(), ""/*cpu name*/, ""/*feature*/, options))
+        , target_machine(target->createTargetMachine(triple.getTriple(), detail::target_cpu_name(opts), detail::target_feature_string(opts), options))
         , data_layout(target_machine->getDataLayout())
         , llvm_context(llvm::getGlobalContext())
         , builder(llvm_context)
+        , codegen_opts(opts)
     {
         if (!target) {
             throw code_generation_error{"LLVM IR generator", boost::format("On looking up target with '%1%': %2%") % triple.getTriple() % tmp_buffer};
@@ -0,0 +1,303 @@
+#if !defined DACHS_CODEGEN_LLVMIR_DEBUG_INFO_EMITTER_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_DEBUG_INFO_EMITTER_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/DIBuilder.h>
+#include <llvm/DebugInfo.h>
+#include <llvm/Support/Dwarf.h>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/semantics/type.hpp"
+#include "dachs/semantics/scope.hpp"
+#include "dachs/semantics/symbol.hpp"
+#include "dachs/codegen/llvmir/context.hpp"
+#include "dachs/codegen/llvmir/type_ir_emitter.hpp"
+#include "dachs/helper/util.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+
+// Note:
+// Emits DWARF debug information (-g).  A function is a subprogram and a statement block
+// is a lexical block.  The source location of the node being emitted is attached to
+// each instruction.
+class debug_info_emitter {
+    context &ctx;
+    type_ir_emitter &type_emitter;
+    llvm::DIBuilder builder;
+    llvm::DIFile file;
+    std::vector<llvm::DIDescriptor> scopes; // Scopes of the function being emitted
+    std::unordered_map<std::string, llvm::DIType> type_cache;
+
+    static std::pair<std::string, std::string> split_path(std::string const& path)
+    {
+        auto const slash_pos = path.rfind('/');
+        if (slash_pos == std::string::npos) {
+            return {path, "."};
+        }
+        return {path.substr(slash_pos + 1), path.substr(0, slash_pos)};
+    }
+
+    llvm::DIType emit_basic_type(type::builtin_type const& builtin)
+    {
+        auto const& name = builtin->name;
+        if (name == "int") {
+            return builder.createBasicType(name, 64u, 64u, llvm::dwarf::DW_ATE_signed);
+        } else if (name == "uint") {
+            return builder.createBasicType(name, 64u, 64u, llvm::dwarf::DW_ATE_unsigned);
+        } else if (name == "float") {
+            return builder.createBasicType(name, 64u, 64u, llvm::dwarf::DW_ATE_float);
+        } else if (name == "char") {
+            return builder.createBasicType(name, 8u, 8u, llvm::dwarf::DW_ATE_signed_char);
+        } else if (name == "bool") {
+            return builder.createBasicType(name, 8u, 8u, llvm::dwarf::DW_ATE_boolean);
+        } else if (name == "string" || name == "symbol") {
+            auto const char_type = builder.createBasicType("char", 8u, 8u, llvm::dwarf::DW_ATE_signed_char);
+            return builder.createPointerType(char_type, 64u, 64u, name);
+        } else {
+            return builder.createUnspecifiedType(name);
+        }
+    }
+
+    llvm::DIType emit_tuple_type(type::tuple_type const& tuple, std::string const& name)
+    {
+        auto *const type_ir = llvm::cast<llvm::StructType>(type_emitter.emit(tuple));
+        auto const* const layout = ctx.data_layout->getStructLayout(type_ir);
+
+        std::vector<llvm::Value *> members;
+        for (auto const idx : helper::indices(tuple->element_types.size())) {
+            auto *const elem_ir = type_ir->getElementType(idx);
+            members.push_back(
+                    builder.createMemberType(
+                        file,
+                        std::to_string(idx),
+                        file,
+                        0u,
+                        ctx.data_layout->getTypeSizeInBits(elem_ir),
+                        ctx.data_layout->getABITypeAlignment(elem_ir) * 8u,
+                        layout->getElementOffsetInBits(idx),
+                        0u,
+                        emit_type(tuple->element_types[idx])
+                    )
+                );
+        }
+
+        return builder.createStructType(
+                file,
+                name,
+                file,
+                0u,
+                layout->getSizeInBits(),
+                ctx.data_layout->getABITypeAlignment(type_ir) * 8u,
+                0u,
+                llvm::DIType(),
+                builder.getOrCreateArray(members)
+            );
+    }
+
+    llvm::DIType emit_fixed_array_type(type::array_type const& array)
+    {
+        auto *const type_ir = type_emitter.emit(array);
+        std::vector<llvm::Value *> subscripts = {builder.getOrCreateSubrange(0, *array->size)};
+        return builder.createArrayType(
+                ctx.data_layout->getTypeSizeInBits(type_ir),
+                ctx.data_layout->getABITypeAlignment(type_ir) * 8u,
+                emit_type(array->element_type),
+                builder.getOrCreateArray(subscripts)
+            );
+    }
+
+    llvm::DIType emit_type(type::type const& t)
+    {
+        auto const name = t.to_string();
+        auto const cached = type_cache.find(name);
+        if (cached != std::end(type_cache)) {
+            return cached->second;
+        }
+
+        llvm::DIType result;
+        if (auto const builtin = type::get<type::builtin_type>(t)) {
+            result = emit_basic_type(*builtin);
+        } else if (auto const tuple = type::get<type::tuple_type>(t)) {
+            result = emit_tuple_type(*tuple, name);
+        } else if (auto const array = type::get<type::array_type>(t)) {
+            result = (*array)->size ? emit_fixed_array_type(*array) : builder.createUnspecifiedType(name);
+        } else {
+            // Note:
+            // Dynamic arrays, ranges and lambda objects are opaque for debuggers now
+            result = builder.createUnspecifiedType(name);
+        }
+
+        type_cache.emplace(name, result);
+        return result;
+    }
+
+public:
+
+    // Note:
+    // Restores the previous location at the end of its lifetime
+    class scoped_location {
+        llvm::IRBuilder<> *ir_builder;
+        llvm::DebugLoc saved;
+
+    public:
+
+        scoped_location() noexcept
+            : ir_builder(nullptr), saved()
+        {}
+
+        scoped_location(llvm::IRBuilder<> &b, llvm::DebugLoc const& new_loc)
+            : ir_builder(&b), saved(b.getCurrentDebugLocation())
+        {
+            b.SetCurrentDebugLocation(new_loc);
+        }
+
+        scoped_location(scoped_location &&rhs) noexcept
+            : ir_builder(rhs.ir_builder), saved(rhs.saved)
+        {
+            rhs.ir_builder = nullptr;
+        }
+
+        scoped_location(scoped_location const&) = delete;
+        scoped_location &operator=(scoped_location const&) = delete;
+
+        ~scoped_location()
+        {
+            if (ir_builder) {
+                ir_builder->SetCurrentDebugLocation(saved);
+            }
+        }
+    };
+
+    debug_info_emitter(context &c, type_ir_emitter &t, llvm::Module &module, std::string const& file_path)
+        : ctx(c), type_emitter(t), builder(module)
+    {
+        auto const path = split_path(file_path);
+        builder.createCompileUnit(
+                // Note:
+                // Dachs has no DWARF language code.  C is the nearest for debuggers.
+                llvm::dwarf::DW_LANG_C,
+                path.first,
+                path.second,
+                "Dachs",
+                false, // Not optimized
+                "",
+                0u // Runtime version
+            );
+        file = builder.createFile(path.first, path.second);
+        module.addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+    }
+
+    void begin_function(ast::node::function_definition const& func_def, llvm::Function *const func_ir)
+    {
+        assert(!func_def->scope.expired());
+        auto const scope = func_def->scope.lock();
+
+        std::vector<llvm::Value *> signature_types;
+        signature_types.push_back(func_def->ret_type ? emit_type(*func_def->ret_type) : emit_type(type::get_unit_type()));
+        for (auto const& p : scope->params) {
+            signature_types.push_back(emit_type(p->type));
+        }
+
+        auto const subprogram = builder.createFunction(
+                file,
+                scope->name,
+                func_ir->getName(),
+                file,
+                func_def->line,
+                builder.createSubroutineType(file, builder.getOrCreateArray(signature_types)),
+                func_ir->hasInternalLinkage(),
+                true, // Definition
+                func_def->line,
+                llvm::DIDescriptor::FlagPrototyped,
+                false, // Not optimized
+                func_ir
+            );
+
+        scopes.clear();
+        scopes.push_back(subprogram);
+        ctx.builder.SetCurrentDebugLocation(llvm::DebugLoc::get(func_def->line, func_def->col, subprogram));
+    }
+
+    template<class Node>
+    void begin_block(Node const& node)
+    {
+        assert(!scopes.empty());
+        scopes.push_back(builder.createLexicalBlock(scopes.back(), file, node->line, node->col));
+    }
+
+    void end_block()
+    {
+        assert(scopes.size() > 1u);
+        scopes.pop_back();
+    }
+
+    template<class Node>
+    scoped_location location_of(Node const& node)
+    {
+        if (scopes.empty() || node->line == 0u) {
+            return {};
+        }
+        return {ctx.builder, llvm::DebugLoc::get(node->line, node->col, scopes.back())};
+    }
+
+    // Note:
+    // A variable in memory is declared with llvm.dbg.declare.  A variable in register is
+    // described with llvm.dbg.value.  'arg_no' is 1-origin index of parameters or 0 for
+    // local variables.
+    template<class Node>
+    void declare_variable(symbol::var_symbol const& sym, llvm::Value *const value, Node const& node, unsigned const arg_no = 0u)
+    {
+        if (scopes.empty() || !value) {
+            return;
+        }
+
+        // Note:
+        // A value which is neither the variable itself nor its memory (e.g. the address of
+        // an array element) can't be described.
+        auto const in_memory = llvm::isa<llvm::AllocaInst>(value);
+        if (!in_memory && value->getType() != type_emitter.emit(sym->type)) {
+            return;
+        }
+
+        auto const var = builder.createLocalVariable(
+                arg_no == 0u ? llvm::dwarf::DW_TAG_auto_variable : llvm::dwarf::DW_TAG_arg_variable,
+                scopes.back(),
+                sym->name,
+                file,
+                node->line,
+                emit_type(sym->type),
+                true, // Preserve even if optimized out
+                0u,
+                arg_no
+            );
+
+        auto *const insert_block = ctx.builder.GetInsertBlock();
+        auto *const intrinsic
+            = in_memory ?
+                builder.insertDeclare(value, var, insert_block) :
+                builder.insertDbgValueIntrinsic(value, 0u, var, insert_block);
+        intrinsic->setDebugLoc(llvm::DebugLoc::get(node->line, node->col, scopes.back()));
+    }
+
+    void finalize()
+    {
+        builder.finalize();
+    }
+};
+
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_DEBUG_INFO_EMITTER_HPP_INCLUDED
@@ -0,0 +1,198 @@
+#if !defined DACHS_CODEGEN_LLVMIR_DYNAMIC_ARRAY_IR_EMITTER_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_DYNAMIC_ARRAY_IR_EMITTER_HPP_INCLUDED
+
+#include <vector>
+#include <initializer_list>
+#include <cassert>
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Value.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+
+#include "dachs/codegen/llvmir/context.hpp"
+#include "dachs/codegen/llvmir/ir_builder_helper.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+
+// Note:
+// A dynamic array (an array type without static size) is a handle to the header in heap.
+// The header is allocated by libdachs and has the layout below.
+//
+//   struct { i8* data; i64 length; i64 capacity; }
+//
+// The handle is typed as i8* so that it is never regarded as an aggregate value.
+// Copying a dynamic array copies the handle.  So dynamic arrays have reference semantics.
+namespace dynamic_array {
+
+enum header_field : unsigned {
+    data = 0u,
+    length = 1u,
+    capacity = 2u,
+};
+
+inline llvm::StructType *get_header_type(context &ctx)
+{
+    return llvm::StructType::get(
+            ctx.llvm_context,
+            std::vector<llvm::Type *>{
+                ctx.builder.getInt8PtrTy(),
+                ctx.builder.getInt64Ty(),
+                ctx.builder.getInt64Ty()
+            }
+        );
+}
+
+inline llvm::Value *emit_header_field_ptr(context &ctx, llvm::Value *const handle, header_field const field)
+{
+    auto *const header = ctx.builder.CreateBitCast(handle, get_header_type(ctx)->getPointerTo());
+    return ctx.builder.CreateStructGEP(header, field);
+}
+
+inline llvm::Value *emit_length(context &ctx, llvm::Value *const handle)
+{
+    return ctx.builder.CreateLoad(emit_header_field_ptr(ctx, handle, length), "array.length");
+}
+
+inline llvm::Value *emit_data(context &ctx, llvm::Value *const handle, llvm::Type *const elem_type)
+{
+    auto *const data_val = ctx.builder.CreateLoad(emit_header_field_ptr(ctx, handle, data), "array.data");
+    return ctx.builder.CreateBitCast(data_val, elem_type->getPointerTo());
+}
+
+} // namespace dynamic_array
+
+class dynamic_array_ir_emitter {
+    using val = llvm::Value *;
+
+    context &ctx;
+    llvm::Module *module = nullptr;
+
+    llvm::Function *get_runtime_func(
+            char const* const name,
+            llvm::Type *const ret_type,
+            std::vector<llvm::Type *> const& param_types,
+            std::initializer_list<llvm::Attribute::AttrKind> const attrs = {}) const
+    {
+        assert(module);
+        return llvmir::get_runtime_func(*module, name, ret_type, param_types, attrs);
+    }
+
+    val elem_size_of(llvm::Type *const elem_type) const
+    {
+        return ctx.builder.getInt64(ctx.data_layout->getTypeAllocSize(elem_type));
+    }
+
+    val to_i64(val const v) const
+    {
+        return v->getType()->isIntegerTy(64u) ? v : ctx.builder.CreateIntCast(v, ctx.builder.getInt64Ty(), false);
+    }
+
+public:
+
+    explicit dynamic_array_ir_emitter(context &c) noexcept
+        : ctx(c)
+    {}
+
+    void set_module(llvm::Module *const m) noexcept
+    {
+        module = m;
+    }
+
+    // Note:
+    // Allocate an array whose elements are 0-cleared.  When 'init' is specified,
+    // all elements are initialized with it.
+    val emit_new(llvm::Type *const elem_type, val const length, val const init = nullptr)
+    {
+        auto *const new_func = get_runtime_func(
+                "__dachs_array_new__",
+                ctx.builder.getInt8PtrTy(),
+                {ctx.builder.getInt64Ty(), ctx.builder.getInt64Ty()}
+            );
+        auto *const length_val = to_i64(length);
+        auto *const handle = ctx.builder.CreateCall2(new_func, elem_size_of(elem_type), length_val, "array");
+
+        if (!init) {
+            return handle;
+        }
+
+        auto *const data_val = dynamic_array::emit_data(ctx, handle, elem_type);
+        auto *const parent = ctx.builder.GetInsertBlock()->getParent();
+        auto *const preheader_block = ctx.builder.GetInsertBlock();
+        auto *const header_block = llvm::BasicBlock::Create(ctx.llvm_context, "array.fill.header", parent);
+        auto *const body_block = llvm::BasicBlock::Create(ctx.llvm_context, "array.fill.body", parent);
+        auto *const exit_block = llvm::BasicBlock::Create(ctx.llvm_context, "array.fill.exit", parent);
+
+        ctx.builder.CreateBr(header_block);
+        ctx.builder.SetInsertPoint(header_block);
+        auto *const idx_val = ctx.builder.CreatePHI(ctx.builder.getInt64Ty(), 2u, "array.fill.i");
+        idx_val->addIncoming(ctx.builder.getInt64(0u), preheader_block);
+        ctx.builder.CreateCondBr(ctx.builder.CreateICmpULT(idx_val, length_val), body_block, exit_block);
+
+        ctx.builder.SetInsertPoint(body_block);
+        ctx.builder.CreateStore(init, ctx.builder.CreateInBoundsGEP(data_val, idx_val));
+        idx_val->addIncoming(ctx.builder.CreateAdd(idx_val, ctx.builder.getInt64(1u)), body_block);
+        ctx.builder.CreateBr(header_block);
+
+        ctx.builder.SetInsertPoint(exit_block);
+        return handle;
+    }
+
+    // Note:
+    // Out-of-bounds index is reported by libdachs and the program is aborted.
+    // The path is marked as cold.  Both 'index' and 'length' must be i64.
+    void emit_bounds_check(val const index, val const length)
+    {
+        auto *const parent = ctx.builder.GetInsertBlock()->getParent();
+        auto *const ok_block = llvm::BasicBlock::Create(ctx.llvm_context, "index.ok", parent);
+        auto *const fail_block = llvm::BasicBlock::Create(ctx.llvm_context, "index.fail", parent);
+
+        ctx.builder.CreateCondBr(ctx.builder.CreateICmpULT(index, length), ok_block, fail_block);
+
+        ctx.builder.SetInsertPoint(fail_block);
+        auto *const fail_func = get_runtime_func(
+                "__dachs_array_index_out_of_bounds__",
+                ctx.builder.getVoidTy(),
+                {ctx.builder.getInt64Ty(), ctx.builder.getInt64Ty()},
+                {llvm::Attribute::NoReturn, llvm::Attribute::Cold}
+            );
+        ctx.builder.CreateCall2(fail_func, index, length);
+        ctx.builder.CreateUnreachable();
+
+        ctx.builder.SetInsertPoint(ok_block);
+    }
+
+    // Note:
+    // Index out of bounds is checked at run time unless 'checked' is false.
+    val emit_element_ptr(val const handle, llvm::Type *const elem_type, val const index, bool const checked = true)
+    {
+        auto *const index_val = to_i64(index);
+        if (checked) {
+            emit_bounds_check(index_val, dynamic_array::emit_length(ctx, handle));
+        }
+        return ctx.builder.CreateInBoundsGEP(dynamic_array::emit_data(ctx, handle, elem_type), index_val);
+    }
+
+    // Note:
+    // The capacity grows twice when the array is full.  So push is amortized O(1).
+    void emit_push(val const handle, val const value)
+    {
+        auto *const push_func = get_runtime_func(
+                "__dachs_array_push_slot__",
+                ctx.builder.getInt8PtrTy(),
+                {ctx.builder.getInt8PtrTy(), ctx.builder.getInt64Ty()}
+            );
+        auto *const elem_type = value->getType();
+        auto *const slot = ctx.builder.CreateCall2(push_func, handle, elem_size_of(elem_type), "array.slot");
+        ctx.builder.CreateStore(value, ctx.builder.CreateBitCast(slot, elem_type->getPointerTo()));
+    }
+};
+
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_DYNAMIC_ARRAY_IR_EMITTER_HPP_INCLUDED
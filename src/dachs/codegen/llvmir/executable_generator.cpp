@@ -10,6 +10,9 @@
 #include <llvm/Target/TargetLibraryInfo.h>
 #include <llvm/Pass.h>
 #include <llvm/PassManager.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Vectorize.h>
 #include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Support/FormattedStream.h>
 
@@ -45,6 +48,20 @@ class binary_generator final {
         // This implies that all passes MUST be allocated with 'new'.
         pm.add(new llvm::DataLayout(*ctx.data_layout));
 
+        // Note:
+        // Do-end blocks and their small callers are marked as always-inline by the IR emitter.
+        // Captures of inlined blocks are promoted to scalars by SROA.
+        pm.add(llvm::createAlwaysInlinerPass());
+        pm.add(llvm::createSROAPass());
+
+        // Note:
+        // Vectorizers query vector registers of the target CPU (--march, --mattr) through
+        // the target transform info added above.  Loops are rotated to have their
+        // conditions at the latches which the loop vectorizer requires.
+        pm.add(llvm::createLoopRotatePass());
+        pm.add(llvm::createLoopVectorizePass());
+        pm.add(llvm::createSLPVectorizerPass());
+
         auto const obj_name = get_base_name_from_module(module) + ".o";
 
         std::string buffer;
@@ -0,0 +1,125 @@
+#if !defined DACHS_CODEGEN_LLVMIR_IDENTICAL_FUNCTION_MERGER_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_IDENTICAL_FUNCTION_MERGER_HPP_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+
+#include <llvm/IR/Function.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "dachs/codegen/llvmir/context.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+namespace detail {
+
+// Note:
+// Identical code folding of instantiated function templates.
+// Instantiations with different argument types often result in the same IR
+// (e.g. int and uint are both i64).  Such functions are merged into one function.
+// Functions are compared with their printed IR.  The name of the function itself is
+// replaced while printing so that self-recursive instantiations can be merged.
+// Merging is repeated until no function is merged because callers of merged
+// functions may become identical after their callees are merged.
+class identical_function_merger {
+    code_size_stats &stats;
+
+    static std::size_t num_instructions(llvm::Function const& f)
+    {
+        std::size_t num = 0u;
+        for (auto const& b : f) {
+            num += b.size();
+        }
+        return num;
+    }
+
+    static std::string fingerprint(llvm::Function &f)
+    {
+        auto const name = f.getName().str();
+        f.setName("dachs.icf.self");
+
+        std::string printed;
+        llvm::raw_string_ostream os{printed};
+        f.print(os);
+        os.flush();
+
+        f.setName(name);
+        assert(f.getName() == name);
+
+        return printed;
+    }
+
+    bool is_mergeable(llvm::Function const& canonical, llvm::Function const& f) const
+    {
+        return canonical.getFunctionType() == f.getFunctionType()
+            && canonical.getAttributes() == f.getAttributes()
+            && canonical.getCallingConv() == f.getCallingConv();
+    }
+
+    bool merge_once(std::vector<llvm::Function *> &funcs)
+    {
+        std::unordered_map<std::string, llvm::Function *> canonicals;
+        std::vector<llvm::Function *> merged;
+
+        for (auto *const f : funcs) {
+            if (f->isDeclaration()) {
+                continue;
+            }
+
+            auto const inserted = canonicals.emplace(fingerprint(*f), f);
+            if (inserted.second) {
+                continue;
+            }
+
+            auto *const canonical = inserted.first->second;
+            if (!is_mergeable(*canonical, *f)) {
+                continue;
+            }
+
+            ++stats.merged_functions;
+            stats.removed_instructions += num_instructions(*f);
+
+            f->replaceAllUsesWith(canonical);
+            f->eraseFromParent();
+            merged.push_back(f);
+        }
+
+        if (merged.empty()) {
+            return false;
+        }
+
+        funcs.erase(
+                std::remove_if(
+                    std::begin(funcs),
+                    std::end(funcs),
+                    [&](auto const f){ return std::find(std::begin(merged), std::end(merged), f) != std::end(merged); }
+                ),
+                std::end(funcs)
+            );
+
+        return true;
+    }
+
+public:
+
+    explicit identical_function_merger(code_size_stats &s) noexcept
+        : stats(s)
+    {}
+
+    void merge(std::vector<llvm::Function *> funcs)
+    {
+        while (merge_once(funcs));
+    }
+};
+
+} // namespace detail
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_IDENTICAL_FUNCTION_MERGER_HPP_INCLUDED
@@ -2,11 +2,19 @@
 #define      DACHS_CODEGEN_LLVMIR_IR_BUILDER_HELPER_HPP_INCLUDED
 
 #include <memory>
+#include <vector>
 #include <algorithm>
+#include <initializer_list>
+#include <cassert>
 
 #include <boost/range/irange.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+
 #include "dachs/exception.hpp"
 #include "dachs/fatal.hpp"
 #include "dachs/codegen/llvmir/context.hpp"
@@ -18,6 +26,54 @@ namespace llvmir {
 using boost::adaptors::filtered;
 using boost::irange;
 
+// Note:
+// Allocas are always placed at the beginning of the entry block of the current function.
+// An alloca in a loop body grows the stack at each iteration, and mem2reg and SROA can
+// promote only allocas in the entry block.
+template<class String = char const* const>
+llvm::AllocaInst *create_alloca_in_entry_block(context &ctx, llvm::Type *const type, String const& name = "")
+{
+    auto *const func = ctx.builder.GetInsertBlock()->getParent();
+    assert(func);
+
+    auto &entry = func->getEntryBlock();
+    auto insert_point = entry.begin();
+    while (insert_point != entry.end() && llvm::isa<llvm::AllocaInst>(*insert_point)) {
+        ++insert_point;
+    }
+
+    llvm::IRBuilder<> entry_builder{&entry, insert_point};
+    return entry_builder.CreateAlloca(type, nullptr, name);
+}
+
+// Note:
+// Functions of the runtime (libdachs and libc) are declared at their first use.  None of
+// them throws.  Other attributes depend on each function; e.g. 'readonly' must be given
+// only to functions which never write memory.
+inline llvm::Function *get_runtime_func(
+        llvm::Module &module,
+        char const* const name,
+        llvm::Type *const ret_type,
+        std::vector<llvm::Type *> const& param_types,
+        std::initializer_list<llvm::Attribute::AttrKind> const attrs = {})
+{
+    if (auto *const f = module.getFunction(name)) {
+        return f;
+    }
+
+    auto *const f = llvm::Function::Create(
+            llvm::FunctionType::get(ret_type, param_types, false),
+            llvm::Function::ExternalLinkage,
+            name,
+            &module
+        );
+    f->addFnAttr(llvm::Attribute::NoUnwind);
+    for (auto const a : attrs) {
+        f->addFnAttr(a);
+    }
+    return f;
+}
+
 template<class Node>
 class basic_ir_builder_helper {
     using node_type = std::shared_ptr<Node>;
@@ -174,16 +230,24 @@ public:
         auto *const type = from->getType();
         // Note:
         // Absorb the difference between value types and reference types
-        return check(
-            ctx.builder.CreateAlloca(
-                llvm::isa<llvm::AllocaInst>(from) || llvm::isa<llvm::GetElementPtrInst>(from) ?
-                    type->getPointerElementType()
-                  : type
-                , array_size
-                , name
-            )
-            , "alloca instruction"
-        );
+        auto *const allocated_type
+            = llvm::isa<llvm::AllocaInst>(from) || llvm::isa<llvm::GetElementPtrInst>(from) ?
+                type->getPointerElementType()
+              : type;
+
+        if (array_size) {
+            // Note:
+            // Dynamically sized alloca must be placed where the size is calculated
+            return check(ctx.builder.CreateAlloca(allocated_type, array_size, name), "alloca instruction");
+        }
+
+        return check(create_alloca_in_entry_block(allocated_type, name), "alloca instruction");
+    }
+
+    template<class String = char const* const>
+    llvm::AllocaInst *create_alloca_in_entry_block(llvm::Type *const type, String const& name = "")
+    {
+        return llvmir::create_alloca_in_entry_block(ctx, type, name);
     }
 
     template<class String = char const* const>
@@ -199,6 +263,45 @@ public:
         return allocated;
     }
 
+    // Note:
+    // Move is a shallow copy.  Memory referred from the moved value is taken over by
+    // the destination.  It is available only when the source is never used after the move.
+    template<class PtrTypeType>
+    void create_move(llvm::Value *const from, PtrTypeType *const to)
+    {
+        assert(from);
+        assert(to);
+        assert(to->getType()->isPointerTy());
+        auto *const t = from->getType();
+
+        if (is_aggregate_ptr(t)) {
+            auto *const aggregate_type = t->getPointerElementType();
+            ctx.builder.CreateMemCpy(
+                to,
+                from,
+                ctx.data_layout->getTypeAllocSize(aggregate_type),
+                ctx.data_layout->getPrefTypeAlignment(aggregate_type)
+            );
+        } else if (llvm::isa<llvm::AllocaInst>(from) || llvm::isa<llvm::GetElementPtrInst>(from)) {
+            ctx.builder.CreateStore(ctx.builder.CreateLoad(from), to);
+        } else {
+            ctx.builder.CreateStore(from, to);
+        }
+    }
+
+    template<class String = char const* const>
+    llvm::AllocaInst *alloc_and_move(llvm::Value *const from, String const& name = "")
+    {
+        auto *const allocated
+            = check(
+                create_alloca(from, nullptr, name)
+                , "alloc and move"
+            );
+
+        create_move(from, allocated);
+        return allocated;
+    }
+
     template<class PtrTypeType>
     void create_deep_copy(llvm::Value *const from, PtrTypeType *const to)
     {
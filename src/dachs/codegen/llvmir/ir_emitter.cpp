@@ -1,9 +1,13 @@
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <vector>
 #include <memory>
 #include <utility>
 #include <string>
 #include <iostream>
 #include <stack>
+#include <cstddef>
 #include <cstdint>
 #include <cassert>
 
@@ -33,6 +37,14 @@
 #include "dachs/codegen/llvmir/ir_builder_helper.hpp"
 #include "dachs/codegen/llvmir/tmp_member_ir_emitter.hpp"
 #include "dachs/codegen/llvmir/tmp_constructor_ir_emitter.hpp"
+#include "dachs/codegen/llvmir/identical_function_merger.hpp"
+#include "dachs/codegen/llvmir/dynamic_array_ir_emitter.hpp"
+#include "dachs/codegen/llvmir/name_mangler.hpp"
+#include "dachs/codegen/llvmir/abi.hpp"
+#include "dachs/codegen/llvmir/tbaa_annotator.hpp"
+#include "dachs/codegen/llvmir/debug_info_emitter.hpp"
+#include "dachs/codegen/llvmir/profile_instrumenter.hpp"
+#include "dachs/codegen/llvmir/perfect_hash.hpp"
 #include "dachs/ast/ast.hpp"
 #include "dachs/semantics/symbol.hpp"
 #include "dachs/semantics/scope.hpp"
@@ -54,6 +66,7 @@ using helper::variant::apply_lambda;
 using helper::variant::get_as;
 using boost::adaptors::transformed;
 using boost::algorithm::all_of;
+using boost::algorithm::any_of;
 
 class llvm_ir_emitter {
     using val = llvm::Value *;
@@ -70,6 +83,25 @@ class llvm_ir_emitter {
     type_ir_emitter type_emitter;
     tmp_member_ir_emitter member_emitter;
     tmp_constructor_ir_emitter ctor_emitter;
+    dynamic_array_ir_emitter array_emitter;
+    std::map<std::pair<val, std::vector<val>>, val> pure_call_cache; // Results of pure function calls in the current basic block
+    llvm::BasicBlock *pure_call_cache_block = nullptr;
+    std::vector<std::pair<llvm::Function *, llvm::Function *>> call_edges; // (caller, callee)
+    std::unordered_set<llvm::Function *> do_block_callers; // Functions which are called with do-end block
+    std::unordered_set<llvm::Value *> captured_references; // Pointers to variables captured by reference
+    static constexpr std::size_t max_inlined_do_block_caller_size = 128u; // In number of instructions
+
+    // Note:
+    // A self-recursive function whose recursive calls are in return statements is lowered to a loop.
+    // Immutable parameters are rebound by PHI nodes and mutable parameters are overwritten.
+    struct tail_recursion_loop {
+        semantics::tail_recursion const* recursion;
+        llvm::BasicBlock *header;
+        std::vector<val> param_slots; // PHI node, alloca or nullptr(unused parameter)
+        llvm::PHINode *accumulator;
+    };
+    boost::optional<tail_recursion_loop> tail_loop; // For the function being emitted
+    std::unique_ptr<debug_info_emitter> debug_info; // Only when -g is specified
 
     auto push_loop(llvm::BasicBlock *loop_value)
     {
@@ -152,7 +184,26 @@ class llvm_ir_emitter {
     template<class... NodeTypes>
     auto emit(boost::variant<NodeTypes...> const& ns)
     {
-        return apply_lambda([this](auto const& n){ return emit(n); }, ns);
+        return apply_lambda(
+                [this](auto const& n)
+                {
+                    auto const location = debug_location_of(n);
+                    return emit(n);
+                }, ns);
+    }
+
+    template<class Node>
+    debug_info_emitter::scoped_location debug_location_of(Node const& n)
+    {
+        return debug_info ? debug_info->location_of(n) : debug_info_emitter::scoped_location{};
+    }
+
+    template<class Node>
+    void declare_debug_variable(symbol::var_symbol const& sym, val const value, Node const& n, unsigned const arg_no = 0u)
+    {
+        if (debug_info) {
+            debug_info->declare_variable(sym, value, n, arg_no);
+        }
     }
 
     template<class Node>
@@ -172,21 +223,113 @@ class llvm_ir_emitter {
         }
     }
 
+    semantics::function_effect effect_of(scope::func_scope const& scope) const
+    {
+        auto const found = semantics_ctx.function_effects.find(scope);
+        return found == std::end(semantics_ctx.function_effects) ? semantics::function_effect::impure : found->second;
+    }
+
+    // Note:
+    // Arguments are passed following the calling convention in abi.hpp.
+    // Arguments passed in memory are moved to temporaries in the caller's frame.
+    val create_call(llvm::Value *const callee_ir, std::vector<val> const& args)
+    {
+        auto *const callee_func = llvm::dyn_cast<llvm::Function>(callee_ir);
+        if (!callee_func) {
+            return ctx.builder.CreateCall(callee_ir, args);
+        }
+
+        std::vector<val> abi_args;
+        abi_args.reserve(args.size() + 1u);
+        auto param_itr = callee_func->arg_begin();
+
+        llvm::AllocaInst *ret_slot = nullptr;
+        if (callee_func->hasStructRetAttr()) {
+            ret_slot = create_alloca_in_entry_block(ctx, param_itr->getType()->getPointerElementType(), "ret.slot");
+            abi_args.push_back(ret_slot);
+            ++param_itr;
+        }
+
+        for (auto *const a : args) {
+            assert(param_itr != callee_func->arg_end());
+            if (abi::is_passed_by_pointer(param_itr->getType(), a->getType())) {
+                auto *const tmp = create_alloca_in_entry_block(ctx, a->getType(), "arg.tmp");
+                ctx.builder.CreateStore(a, tmp);
+                abi_args.push_back(tmp);
+            } else {
+                abi_args.push_back(a);
+            }
+            ++param_itr;
+        }
+
+        auto *const call = ctx.builder.CreateCall(callee_func, abi_args);
+        if (!ret_slot) {
+            return call;
+        }
+
+        call->addAttribute(1u, llvm::Attribute::StructRet);
+        return ctx.builder.CreateLoad(ret_slot);
+    }
+
+    // Note:
+    // The result of a pure function call is reused when the same function is called
+    // with the same argument values in the same basic block.
+    val emit_call(scope::func_scope const& callee, llvm::Value *const callee_ir, std::vector<val> const& args)
+    {
+        if (auto *const callee_func = llvm::dyn_cast<llvm::Function>(callee_ir)) {
+            call_edges.emplace_back(ctx.builder.GetInsertBlock()->getParent(), callee_func);
+        }
+
+        if (callee->is_builtin || effect_of(callee) != semantics::function_effect::pure) {
+            return create_call(callee_ir, args);
+        }
+
+        auto *const current_block = ctx.builder.GetInsertBlock();
+        if (current_block != pure_call_cache_block) {
+            pure_call_cache.clear();
+            pure_call_cache_block = current_block;
+        }
+
+        auto const key = std::make_pair(callee_ir, args);
+        auto const cached = pure_call_cache.find(key);
+        if (cached != std::end(pure_call_cache)) {
+            return cached->second;
+        }
+
+        auto *const result = create_call(callee_ir, args);
+        pure_call_cache.emplace(key, result);
+        return result;
+    }
+
     void emit_func_prototype(ast::node::function_definition const& func_def)
     {
         assert(!func_def->scope.expired());
         std::vector<llvm::Type *> param_type_irs;
-        param_type_irs.reserve(func_def->params.size());
+        param_type_irs.reserve(func_def->params.size() + 1u);
         auto const scope = func_def->scope.lock();
+        auto const is_main = scope->name == "main";
 
+        auto *const ret_type_ir = type_emitter.emit(*func_def->ret_type);
+        assert(ret_type_ir);
+        auto const returns_in_memory = !is_main && abi::is_passed_in_memory(ctx, ret_type_ir);
+        if (returns_in_memory) {
+            param_type_irs.push_back(ret_type_ir->getPointerTo());
+        }
+
+        std::vector<unsigned> params_in_memory; // Indices of attributes
         for (auto const& param_sym : scope->params) {
             auto *const t = type_emitter.emit(param_sym->type);
             assert(t);
-            param_type_irs.push_back(t);
+            if (!is_main && abi::is_passed_in_memory(ctx, t)) {
+                param_type_irs.push_back(t->getPointerTo());
+                params_in_memory.push_back(param_type_irs.size());
+            } else {
+                param_type_irs.push_back(t);
+            }
         }
 
         auto *const func_type_ir = llvm::FunctionType::get(
-                type_emitter.emit(*func_def->ret_type),
+                returns_in_memory ? ctx.builder.getVoidTy() : ret_type_ir,
                 param_type_irs,
                 false // Non-variadic
             );
@@ -194,20 +337,60 @@ class llvm_ir_emitter {
         check(func_def, func_type_ir, "function type");
 
         // Note:
-        // Use to_string() instead of mangling.
+        // Only "main" is visible from outside of the module.  Other functions are internal
+        // so that LLVM can inline them freely and remove them when they are no longer used.
         auto *const func_ir = llvm::Function::Create(
                 func_type_ir,
-                llvm::Function::ExternalLinkage,
+                is_main ? llvm::Function::ExternalLinkage : llvm::Function::InternalLinkage,
                 // Note:
                 // Simply use "main" because lli requires "main" function as entry point of the program
-                scope->name == "main" ? "main" : scope->to_string(),
+                is_main ? "main" : mangle(scope),
                 module
             );
 
+        // Note:
+        // Dachs has no exception.  Functions never unwind.
+        func_ir->addFnAttr(llvm::Attribute::NoUnwind);
+
+        if (returns_in_memory) {
+            func_ir->addAttribute(1u, llvm::Attribute::StructRet);
+            func_ir->addAttribute(1u, llvm::Attribute::NoAlias);
+        }
+
+        // Note:
+        // The caller always passes a fresh temporary.  So the memory is never aliased.
+        for (auto const idx : params_in_memory) {
+            func_ir->addAttribute(idx, llvm::Attribute::NoAlias);
+            func_ir->addAttribute(idx, llvm::Attribute::ReadOnly);
+            func_ir->addAttribute(idx, llvm::Attribute::NoCapture);
+        }
+
+        // Note:
+        // A function which returns a value in memory writes the memory.  A pure function
+        // which receives parameters in memory reads them.
+        switch (effect_of(scope)) {
+        case semantics::function_effect::pure:
+            if (!returns_in_memory) {
+                func_ir->addFnAttr(params_in_memory.empty() ? llvm::Attribute::ReadNone : llvm::Attribute::ReadOnly);
+            }
+            break;
+        case semantics::function_effect::readonly:
+            if (!returns_in_memory) {
+                func_ir->addFnAttr(llvm::Attribute::ReadOnly);
+            }
+            break;
+        default:
+            break;
+        }
+
         check(func_def, func_type_ir, "function");
 
         {
             auto arg_itr = func_ir->arg_begin();
+            if (returns_in_memory) {
+                arg_itr->setName("ret.slot");
+                ++arg_itr;
+            }
             auto param_itr = std::begin(scope->params);
             for (; param_itr != std::end(scope->params); ++arg_itr, ++param_itr) {
                 arg_itr->setName((*param_itr)->name);
@@ -218,6 +401,52 @@ class llvm_ir_emitter {
         func_table.emplace(scope, func_ir);
     }
 
+    static bool refers_other_memory(type::type const& t)
+    {
+        if (auto const tuple = type::get<type::tuple_type>(t)) {
+            return !all_of((*tuple)->element_types, [](auto const& e){ return type::type{e}.is_builtin(); });
+        } else if (auto const array = type::get<type::array_type>(t)) {
+            return !type::type{(*array)->element_type}.is_builtin();
+        } else {
+            return !t.is_builtin();
+        }
+    }
+
+    // Note:
+    // The value of the expression can be moved instead of being deep-copied when it is the last use
+    // of a mutable variable or a temporary aggregate whose elements don't refer other memory.
+    bool is_movable(ast::node::any_expr const& e) const
+    {
+        if (auto const var = get_as<ast::node::var_ref>(e)) {
+            return helper::exists(semantics_ctx.last_uses, *var);
+        }
+
+        if (helper::variant::has<ast::node::tuple_literal>(e) || helper::variant::has<ast::node::array_literal>(e)) {
+            return !refers_other_memory(type::type_of(e));
+        }
+
+        return false;
+    }
+
+    // Note:
+    // An element of a dynamic array lives in the heap buffer of the array.  push() may reallocate
+    // the buffer, so a pointer to the element must not be bound to a variable.
+    bool refers_dynamic_array_element(ast::node::any_expr const& e) const
+    {
+        auto const access = get_as<ast::node::index_access>(e);
+        if (!access) {
+            return false;
+        }
+
+        if (auto const array = type::get<type::array_type>(type::type_of((*access)->child))) {
+            if (!(*array)->size) {
+                return true;
+            }
+        }
+
+        return refers_dynamic_array_element((*access)->child);
+    }
+
     bool is_available_type_for_binary_expression(type::type const& lhs, type::type const& rhs) const noexcept
     {
         if (type::is_a<type::tuple_type>(lhs) && type::is_a<type::tuple_type>(rhs)) {
@@ -270,15 +499,9 @@ class llvm_ir_emitter {
                     emitter.error(access, "Index is not a constant.");
                 }
                 return emitter.ctx.builder.CreateStructGEP(child_val, constant_index->getZExtValue());
-            } else if (type::is_a<type::array_type>(child_type)) {
+            } else if (auto const maybe_array_type = type::get<type::array_type>(child_type)) {
                 assert(!index_val->getType()->isPointerTy());
-                return emitter.ctx.builder.CreateInBoundsGEP(
-                        child_val,
-                        (val [2]){
-                            emitter.ctx.builder.getInt64(0u),
-                            index_val
-                        }
-                    );
+                return emitter.emit_array_element_ptr(access, *maybe_array_type, child_val, index_val);
             } else {
                 emitter.error(access, "Not a tuple value (in assignment statement)");
             }
@@ -310,9 +533,10 @@ public:
         , var_table(ctx)
         , builtin_func_emitter(ctx.llvm_context)
         , file(f)
-        , type_emitter(ctx.llvm_context, sc.lambda_captures)
+        , type_emitter(ctx.llvm_context, sc.lambda_captures, sc.non_escaping_lambdas)
         , member_emitter(ctx)
         , ctor_emitter(ctx, type_emitter)
+        , array_emitter(ctx)
     {}
 
     // Note:
@@ -325,7 +549,9 @@ public:
     {
         // XXX:
         // This condition is too ad hoc.
-        if (llvm::isa<llvm::AllocaInst>(value) || llvm::isa<llvm::GetElementPtrInst>(value)) {
+        if (llvm::isa<llvm::AllocaInst>(value)
+                || llvm::isa<llvm::GetElementPtrInst>(value)
+                || helper::exists(captured_references, value)) {
             return ctx.builder.CreateLoad(value);
         } else {
             return value;
@@ -387,6 +613,13 @@ public:
         return check(pl, boost::apply_visitor(visitor, pl->value), "constant");
     }
 
+    val emit(ast::node::symbol_literal const& sym)
+    {
+        // Note:
+        // A symbol is represented as a pointer to its name like a string
+        return check(sym, ctx.builder.CreateGlobalStringPtr(sym->value.c_str()), "symbol");
+    }
+
     template<class Expr>
     val emit_tuple_constant(type::tuple_type const& t, std::vector<Expr> const& elem_exprs)
     {
@@ -406,7 +639,7 @@ public:
 
             return llvm::ConstantStruct::getAnon(ctx.llvm_context, elem_consts);
         } else {
-            auto *const alloca_inst = ctx.builder.CreateAlloca(type_emitter.emit(t));
+            auto *const alloca_inst = create_alloca_in_entry_block(ctx, type_emitter.emit(t));
             for (auto const idx : helper::indices(elem_values.size())) {
                 auto *const elem_val = get_operand(elem_values[idx]);
                 ctx.builder.CreateStore(
@@ -452,7 +685,7 @@ public:
 
             return llvm::ConstantArray::get(type_emitter.emit_fixed_array(t), elem_consts);
         } else {
-            auto *const alloca_inst = ctx.builder.CreateAlloca(type_emitter.emit(t));
+            auto *const alloca_inst = create_alloca_in_entry_block(ctx, type_emitter.emit(t));
             for (auto const idx : helper::indices(elem_exprs.size())) {
                 ctx.builder.CreateStore(
                         get_operand(emit(elem_exprs[idx])),
@@ -493,6 +726,38 @@ public:
             );
     }
 
+    // Note:
+    // The lambda object which doesn't escape refers captured aggregates through pointers.
+    // The pointers point to the variables in the current function.  So they are not copied.
+    val emit_non_escaping_lambda_object(type::generic_func_type const& g, ast::node::tuple_literal const& captured_values)
+    {
+        auto const lambda_scope = g->ref->lock();
+        auto *const alloca_inst = create_alloca_in_entry_block(ctx, type_emitter.emit(g));
+
+        for (auto const& capture : semantics_ctx.lambda_captures.at(lambda_scope).get<semantics::tags::offset>()) {
+            assert(capture.offset < captured_values->element_exprs.size());
+            auto *const value = emit(captured_values->element_exprs[capture.offset]);
+            auto *const field = ctx.builder.CreateStructGEP(alloca_inst, capture.offset);
+
+            if (!semantics::is_captured_by_reference(semantics_ctx.non_escaping_lambdas, lambda_scope, capture)) {
+                ctx.builder.CreateStore(get_operand(value), field);
+                continue;
+            }
+
+            if (value->getType()->isPointerTy()) {
+                ctx.builder.CreateStore(value, field);
+            } else {
+                // Note:
+                // The captured value is not on memory (e.g. constant).  Put it on the stack.
+                auto *const tmp = create_alloca_in_entry_block(ctx, value->getType());
+                ctx.builder.CreateStore(value, tmp);
+                ctx.builder.CreateStore(tmp, field);
+            }
+        }
+
+        return alloca_inst;
+    }
+
     val emit(ast::node::lambda_expr const& lambda)
     {
         auto const g = type::get<type::generic_func_type>(lambda->type);
@@ -505,6 +770,15 @@ public:
             return llvm::ConstantStruct::get(type_emitter.emit(*g), {});
         }
 
+        auto const& g_ = *g;
+        if (g_->ref && !g_->ref->expired()) {
+            auto const lambda_scope = g_->ref->lock();
+            if (helper::exists(semantics_ctx.non_escaping_lambdas, lambda_scope)
+                    && helper::exists(semantics_ctx.lambda_captures, lambda_scope)) {
+                return check(lambda, emit_non_escaping_lambda_object(g_, instantiation_itr->second), "non-escaping lambda object");
+            }
+        }
+
         return emit(instantiation_itr->second);
     }
 
@@ -519,6 +793,11 @@ public:
         module->setTargetTriple(ctx.triple.getTriple());
 
         builtin_func_emitter.set_module(module);
+        array_emitter.set_module(module);
+
+        if (ctx.codegen_opts.debug_info) {
+            debug_info = std::make_unique<debug_info_emitter>(ctx, type_emitter, *module, file);
+        }
 
         auto const emit_func_def_prototype
             = [&](auto const& def)
@@ -548,6 +827,25 @@ public:
 
         assert(loop_stack.empty());
 
+        inline_small_do_block_callers();
+
+        merge_identical_instantiations(p);
+
+        // Note:
+        // Probe points are enumerated from the final IR so that keys of the instrumented
+        // build match keys of the optimized build.
+        if (ctx.codegen_opts.profile_generate) {
+            detail::profile_instrumenter{ctx, *module}.instrument();
+        } else if (!ctx.codegen_opts.profile_use_file.empty()) {
+            detail::profile_annotator{ctx, *module, ctx.codegen_opts.profile_use_file}.annotate();
+        }
+
+        tbaa_annotator{ctx}.annotate(*module);
+
+        if (debug_info) {
+            debug_info->finalize();
+        }
+
         return module;
     }
 
@@ -561,6 +859,22 @@ public:
         assert(!param->param_symbol.expired());
 
         auto const param_sym = param->param_symbol.lock();
+
+        // Note:
+        // A parameter passed in memory is loaded at first.  LLVM's optimizations
+        // break the loaded aggregate into loads of the elements actually used.
+        // The memory is not invariant because a caller rewrites it on each call.
+        // 'noalias' and 'readonly' attributes of the parameter are enough.
+        {
+            auto *const arg_val = var_table.lookup_register_value(param_sym);
+            assert(arg_val);
+            if (abi::is_passed_by_pointer(arg_val->getType(), type_emitter.emit(param_sym->type))) {
+                auto *const loaded = ctx.builder.CreateLoad(arg_val, param_sym->name);
+                var_table.erase_register_value(param_sym);
+                var_table.insert(param_sym, loaded);
+            }
+        }
+
         if (!param_sym->immutable) {
             // Note:
             // The parameter is already registered as register value for variable table in emit_func_prototype()
@@ -585,6 +899,77 @@ public:
 
     }
 
+    std::vector<llvm::Function *> instantiated_funcs_of(ast::node::inu const& p)
+    {
+        std::vector<llvm::Function *> instantiated_funcs;
+        for (auto const& i : p->definitions) {
+            auto const maybe_func_def = get_as<ast::node::function_definition>(i);
+            if (!maybe_func_def || !(*maybe_func_def)->is_template()) {
+                continue;
+            }
+
+            for (auto const& instantiated_func_def : (*maybe_func_def)->instantiated) {
+                if (auto const func_ir = lookup_func(instantiated_func_def->scope.lock())) {
+                    instantiated_funcs.push_back(*func_ir);
+                }
+            }
+        }
+        return instantiated_funcs;
+    }
+
+    // Note:
+    // A do-end block is called only by the instantiation of its callee because the type
+    // of each block is unique.  The block is always inlined into the callee and the callee
+    // is inlined into its caller when it is small.  After that, the captures of the block
+    // are scalarized and the internal iteration is compiled to a plain loop.
+    void mark_do_block_for_inlining(ast::node::function_definition const& block, scope::func_scope const& callee)
+    {
+        auto const mark_block
+            = [this](auto const& def)
+            {
+                if (auto const block_ir = lookup_func(def->scope.lock())) {
+                    (*block_ir)->addFnAttr(llvm::Attribute::AlwaysInline);
+                }
+            };
+
+        if (block->is_template()) {
+            for (auto const& i : block->instantiated) {
+                mark_block(i);
+            }
+        } else {
+            mark_block(block);
+        }
+
+        if (auto const callee_ir = lookup_func(callee)) {
+            do_block_callers.insert(*callee_ir);
+        }
+    }
+
+    void inline_small_do_block_callers()
+    {
+        auto const is_self_recursive
+            = [this](llvm::Function *const f)
+            {
+                return any_of(call_edges, [f](auto const& e){ return e.first == f && e.second == f; });
+            };
+
+        for (auto *const f : do_block_callers) {
+            std::size_t num_instructions = 0u;
+            for (auto const& b : *f) {
+                num_instructions += b.size();
+            }
+
+            if (num_instructions <= max_inlined_do_block_caller_size && !is_self_recursive(f)) {
+                f->addFnAttr(llvm::Attribute::AlwaysInline);
+            }
+        }
+    }
+
+    void merge_identical_instantiations(ast::node::inu const& p)
+    {
+        identical_function_merger{ctx.size_stats}.merge(instantiated_funcs_of(p));
+    }
+
     // Note:
     // IR for the function prototype is already emitd in emit(ast::node::inu const&)
     void emit(ast::node::function_definition const& func_def)
@@ -603,8 +988,23 @@ public:
         auto const block = llvm::BasicBlock::Create(ctx.llvm_context, "entry", prototype_ir);
         ctx.builder.SetInsertPoint(block);
 
-        for (auto const& p : func_def->params) {
+        if (debug_info) {
+            debug_info->begin_function(func_def, prototype_ir);
+        }
+
+        for (auto const idx : helper::indices(func_def->params.size())) {
+            auto const& p = func_def->params[idx];
             emit(p);
+            if (!p->param_symbol.expired()) {
+                auto const sym = p->param_symbol.lock();
+                declare_debug_variable(sym, var_table.lookup_value(sym), p, idx + 1u);
+            }
+        }
+
+        tail_loop = boost::none;
+        auto const recursion = semantics_ctx.tail_recursions.find(func_def->scope.lock());
+        if (recursion != std::end(semantics_ctx.tail_recursions)) {
+            begin_tail_recursion_loop(func_def, recursion->second, prototype_ir);
         }
 
         emit(func_def->body);
@@ -628,10 +1028,18 @@ public:
 
     void emit(ast::node::statement_block const& block)
     {
+        if (debug_info) {
+            debug_info->begin_block(block);
+        }
+
         // Basic block is already emitd on visiting function_definition and for_stmt
         for (auto const& stmt : block->value) {
             emit(stmt);
         }
+
+        if (debug_info) {
+            debug_info->end_block();
+        }
     }
 
     void emit(ast::node::if_stmt const& if_)
@@ -670,6 +1078,170 @@ public:
         helper.append_block(end_block);
     }
 
+    void begin_tail_recursion_loop(ast::node::function_definition const& func_def, semantics::tail_recursion const& recursion, llvm::Function *const func_ir)
+    {
+        auto *const preheader_block = ctx.builder.GetInsertBlock();
+        auto *const header_block = llvm::BasicBlock::Create(ctx.llvm_context, "tailrecurse", func_ir);
+        ctx.builder.CreateBr(header_block);
+        ctx.builder.SetInsertPoint(header_block);
+
+        std::vector<val> param_slots;
+        for (auto const& p : func_def->params) {
+            if (p->name == "_" || p->param_symbol.expired()) {
+                param_slots.push_back(nullptr);
+                continue;
+            }
+
+            auto const sym = p->param_symbol.lock();
+            if (!sym->immutable) {
+                param_slots.push_back(var_table.lookup_value(sym));
+                continue;
+            }
+
+            auto *const arg_val = var_table.lookup_register_value(sym);
+            assert(arg_val);
+            auto *const phi = ctx.builder.CreatePHI(arg_val->getType(), 2u, sym->name);
+            phi->addIncoming(arg_val, preheader_block);
+            var_table.erase_register_value(sym);
+            var_table.insert(sym, phi);
+            param_slots.push_back(phi);
+        }
+
+        llvm::PHINode *accumulator = nullptr;
+        if (recursion.accumulator) {
+            auto *const ret_type = func_ir->getReturnType();
+            accumulator = ctx.builder.CreatePHI(ret_type, 2u, "accumulator");
+            accumulator->addIncoming(
+                    llvm::ConstantInt::get(ret_type, *recursion.accumulator == "*" ? 1u : 0u),
+                    preheader_block
+                );
+        }
+
+        tail_loop = tail_recursion_loop{&recursion, header_block, std::move(param_slots), accumulator};
+    }
+
+    val accumulate(val const v)
+    {
+        assert(tail_loop && tail_loop->accumulator);
+        return *tail_loop->recursion->accumulator == "*" ?
+            ctx.builder.CreateMul(tail_loop->accumulator, v, "accumulated") :
+            ctx.builder.CreateAdd(tail_loop->accumulator, v, "accumulated");
+    }
+
+    void emit_jump_to_tail_recursion_loop(ast::node::func_invocation const& invocation, val const accumulated)
+    {
+        assert(tail_loop);
+        assert(invocation->args.size() == tail_loop->param_slots.size());
+
+        // Note:
+        // All arguments must be evaluated before rebinding parameters because arguments
+        // may refer to them.
+        std::vector<val> args;
+        args.reserve(invocation->args.size());
+        for (auto const& a : invocation->args) {
+            args.push_back(get_operand(emit(a)));
+        }
+
+        for (auto const idx : helper::indices(args.size())) {
+            auto *const slot = tail_loop->param_slots[idx];
+            if (slot && !llvm::isa<llvm::PHINode>(slot)) {
+                ctx.builder.CreateStore(args[idx], slot);
+            }
+        }
+
+        auto *const current_block = ctx.builder.GetInsertBlock();
+        for (auto const idx : helper::indices(args.size())) {
+            if (auto *const phi = llvm::dyn_cast_or_null<llvm::PHINode>(tail_loop->param_slots[idx])) {
+                phi->addIncoming(args[idx], current_block);
+            }
+        }
+
+        if (tail_loop->accumulator) {
+            tail_loop->accumulator->addIncoming(accumulated, current_block);
+        }
+
+        ctx.builder.CreateBr(tail_loop->header);
+    }
+
+    bool emit_tail_recursion(ast::node::any_expr const& expr)
+    {
+        auto const is_recursive_call
+            = [this](auto const& e) -> boost::optional<ast::node::func_invocation>
+            {
+                auto const invocation = get_as<ast::node::func_invocation>(e);
+                return invocation && helper::exists(tail_loop->recursion->calls, *invocation) ?
+                    invocation : boost::none;
+            };
+
+        if (auto const invocation = is_recursive_call(expr)) {
+            emit_jump_to_tail_recursion_loop(*invocation, tail_loop->accumulator);
+            return true;
+        }
+
+        auto const bin_expr = get_as<ast::node::binary_expr>(expr);
+        if (!tail_loop->accumulator || !bin_expr) {
+            return false;
+        }
+
+        if (auto const invocation = is_recursive_call((*bin_expr)->lhs)) {
+            emit_jump_to_tail_recursion_loop(*invocation, accumulate(get_operand(emit((*bin_expr)->rhs))));
+            return true;
+        } else if (auto const invocation = is_recursive_call((*bin_expr)->rhs)) {
+            emit_jump_to_tail_recursion_loop(*invocation, accumulate(get_operand(emit((*bin_expr)->lhs))));
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool refers_caller_frame(type::type const& t)
+    {
+        if (auto const g = type::get<type::generic_func_type>(t)) {
+            // Note:
+            // A lambda object may capture variables in the caller's frame by reference
+            return (*g)->ref && !(*g)->ref->expired() && (*g)->ref->lock()->is_anonymous();
+        } else if (auto const tuple = type::get<type::tuple_type>(t)) {
+            return boost::algorithm::any_of((*tuple)->element_types, [](auto const& e){ return refers_caller_frame(type::type{e}); });
+        } else if (auto const array = type::get<type::array_type>(t)) {
+            return refers_caller_frame(type::type{(*array)->element_type});
+        } else {
+            return false;
+        }
+    }
+
+    // Note:
+    // A call in return statement is marked as a tail call when the callee never refers
+    // the caller's frame.  The backend emits it as a jump if possible.
+    void mark_tail_call(ast::node::any_expr const& expr, val const ret_val)
+    {
+        auto *const call = llvm::dyn_cast<llvm::CallInst>(ret_val);
+        auto const invocation = get_as<ast::node::func_invocation>(expr);
+        if (!call || !invocation || (*invocation)->do_block || (*invocation)->callee_scope.expired()) {
+            return;
+        }
+
+        // Note:
+        // The call may be a cached result of pure function call which is not in return position
+        if (call->getParent() != ctx.builder.GetInsertBlock() || call != &call->getParent()->back()) {
+            return;
+        }
+
+        if ((*invocation)->callee_scope.lock()->is_anonymous()
+                || boost::algorithm::any_of((*invocation)->args, [](auto const& a){ return refers_caller_frame(type::type_of(a)); })) {
+            return;
+        }
+
+        // Note:
+        // Arguments passed in memory are temporaries in the caller's frame
+        for (auto const idx : helper::indices(call->getNumArgOperands())) {
+            if (llvm::isa<llvm::AllocaInst>(call->getArgOperand(idx))) {
+                return;
+            }
+        }
+
+        call->setTailCall();
+    }
+
     void emit(ast::node::return_stmt const& return_)
     {
         if (ctx.builder.GetInsertBlock()->getTerminator()) {
@@ -680,7 +1252,30 @@ public:
         }
 
         if (return_->ret_exprs.size() == 1) {
-            ctx.builder.CreateRet(get_operand(emit(return_->ret_exprs[0])));
+            auto const& expr = return_->ret_exprs[0];
+            if (tail_loop && emit_tail_recursion(expr)) {
+                return;
+            }
+
+            auto *const ret_val = get_operand(emit(expr));
+            if (tail_loop && tail_loop->accumulator) {
+                emit_ret(accumulate(ret_val));
+            } else {
+                mark_tail_call(expr, ret_val);
+                emit_ret(ret_val);
+            }
+        } else if (auto *const ret_slot = get_ret_slot()) {
+            // Note:
+            // Return value optimization.  Elements are written to the caller's storage directly.
+            std::vector<val> elem_values;
+            elem_values.reserve(return_->ret_exprs.size());
+            for (auto const& e : return_->ret_exprs) {
+                elem_values.push_back(get_operand(emit(e)));
+            }
+            for (auto const idx : helper::indices(elem_values.size())) {
+                ctx.builder.CreateStore(elem_values[idx], ctx.builder.CreateStructGEP(ret_slot, idx));
+            }
+            ctx.builder.CreateRetVoid();
         } else {
             assert(type::is_a<type::tuple_type>(return_->ret_type));
             ctx.builder.CreateRet(
@@ -694,6 +1289,25 @@ public:
         }
     }
 
+    // Note:
+    // Returns the pointer to the storage for the return value when the current function
+    // returns its value in memory.
+    llvm::Argument *get_ret_slot() const
+    {
+        auto *const func = ctx.builder.GetInsertBlock()->getParent();
+        return func->hasStructRetAttr() ? func->arg_begin() : nullptr;
+    }
+
+    void emit_ret(val const ret_val)
+    {
+        if (auto *const ret_slot = get_ret_slot()) {
+            ctx.builder.CreateStore(ret_val, ret_slot);
+            ctx.builder.CreateRetVoid();
+        } else {
+            ctx.builder.CreateRet(ret_val);
+        }
+    }
+
     template<class Node, class Scope>
     val emit_non_builtin_callee(Node const& n, Scope const& scope)
     {
@@ -703,11 +1317,11 @@ public:
             error(n, boost::format("'%1%' is unresolved overloaded function '%2%'") % scope->name % scope->to_string());
         }
 
-        return check(
-                n,
-                module->getFunction(scope->to_string()),
-                boost::format("generic function variable '%1%' for '%2%'") % scope->to_string() % scope->type.to_string()
-            );
+        auto const func_ir = lookup_func(scope);
+        if (!func_ir) {
+            error(n, boost::format("generic function variable '%1%' for '%2%'") % scope->to_string() % scope->type.to_string());
+        }
+        return *func_ir;
     }
 
     template<class Node, class Scope, class Exprs>
@@ -750,6 +1364,12 @@ public:
         assert((*generic)->ref && !(*generic)->ref->expired());
         auto const callee = invocation->callee_scope.lock();
 
+        if (callee->is_builtin && callee->name == "push") {
+            assert(args.size() == 2u);
+            array_emitter.emit_push(args[0], args[1]);
+            return llvm::ConstantStruct::getAnon(ctx.llvm_context, {});
+        }
+
         // Note:
         // Add a receiver for lambda function invocation
         if (callee->is_anonymous()) {
@@ -757,9 +1377,11 @@ public:
         }
 
         if (invocation->do_block) {
+            mark_do_block_for_inlining(*invocation->do_block, callee);
             return check(
                         invocation,
-                        ctx.builder.CreateCall(
+                        emit_call(
+                            callee,
                             emit_non_builtin_callee(invocation, callee),
                             args
                         ),
@@ -768,7 +1390,8 @@ public:
         } else {
             return check(
                         invocation,
-                        ctx.builder.CreateCall(
+                        emit_call(
+                            callee,
                             emit_callee(invocation, callee, invocation->args),
                             args
                         ),
@@ -800,6 +1423,36 @@ public:
         );
     }
 
+    // Note:
+    // '&&' and '||' are short-circuit.  The right operand is evaluated only when the left
+    // operand doesn't determine the result.  Branches which SimplifyCFG finds cheap are
+    // folded into selects later.
+    val emit_short_circuit_expr(ast::node::binary_expr const& bin_expr)
+    {
+        auto helper = get_ir_helper(bin_expr);
+        bool const is_and = bin_expr->op == "&&";
+
+        auto *const lhs_val = get_operand(emit(bin_expr->lhs));
+        auto *const lhs_end_block = ctx.builder.GetInsertBlock();
+        auto *const rhs_block = helper.create_block_for_parent(is_and ? "and.rhs" : "or.rhs");
+        auto *const end_block = helper.create_block_for_parent(is_and ? "and.end" : "or.end");
+
+        if (is_and) {
+            helper.create_cond_br(lhs_val, rhs_block, end_block, rhs_block);
+        } else {
+            helper.create_cond_br(lhs_val, end_block, rhs_block, rhs_block);
+        }
+
+        auto *const rhs_val = get_operand(emit(bin_expr->rhs));
+        auto *const rhs_end_block = ctx.builder.GetInsertBlock();
+        helper.terminate_with_br(end_block, end_block);
+
+        auto *const phi = ctx.builder.CreatePHI(ctx.builder.getInt1Ty(), 2u, is_and ? "and.tmp" : "or.tmp");
+        phi->addIncoming(ctx.builder.getInt1(!is_and), lhs_end_block);
+        phi->addIncoming(rhs_val, rhs_end_block);
+        return check(bin_expr, phi, boost::format("binary operator '%1%'") % bin_expr->op);
+    }
+
     val emit(ast::node::binary_expr const& bin_expr)
     {
         auto const lhs_type = type::type_of(bin_expr->lhs);
@@ -809,6 +1462,18 @@ public:
             error(bin_expr, "Binary expression now only supports only some builtin types");
         }
 
+        if (auto const maybe_range_type = type::get<type::range_type>(bin_expr->type)) {
+            auto *const range_type_ir = type_emitter.emit(*maybe_range_type);
+            val range_val = llvm::UndefValue::get(range_type_ir);
+            range_val = ctx.builder.CreateInsertValue(range_val, get_operand(emit(bin_expr->lhs)), 0u);
+            range_val = ctx.builder.CreateInsertValue(range_val, get_operand(emit(bin_expr->rhs)), 1u);
+            return check(bin_expr, range_val, "range expression");
+        }
+
+        if (bin_expr->op == "&&" || bin_expr->op == "||") {
+            return emit_short_circuit_expr(bin_expr);
+        }
+
         return check(
             bin_expr,
             tmp_builtin_bin_op_ir_emitter{ctx, get_operand(emit(bin_expr->lhs)), get_operand(emit(bin_expr->rhs)), bin_expr->op}.emit(lhs_type),
@@ -834,6 +1499,51 @@ public:
         }
     }
 
+    bool needs_bounds_check(ast::node::index_access const& access, type::array_type const& array_type) const
+    {
+        if (helper::exists(semantics_ctx.in_bounds_accesses, access)) {
+            return false;
+        }
+        return !array_type->size || ctx.codegen_opts.bounds_check;
+    }
+
+    // Note:
+    // 'array_val' is a handle of dynamic array or a pointer to fixed-size array.
+    val emit_array_element_ptr(ast::node::index_access const& access, type::array_type const& array_type, val const array_val, val const index_val)
+    {
+        auto const checked = needs_bounds_check(access, array_type);
+
+        if (!array_type->size) {
+            return array_emitter.emit_element_ptr(
+                    get_operand(array_val),
+                    type_emitter.emit(array_type->element_type),
+                    index_val,
+                    checked
+                );
+        }
+
+        auto *const index_i64 =
+            index_val->getType()->isIntegerTy(64u) ?
+                index_val :
+                ctx.builder.CreateIntCast(index_val, ctx.builder.getInt64Ty(), true);
+
+        if (auto const constant_index = llvm::dyn_cast<llvm::ConstantInt>(index_i64)) {
+            if (constant_index->getZExtValue() >= *array_type->size) {
+                error(access, boost::format("Array index is out of bounds (size:%1%, index:%2%)") % *array_type->size % constant_index->getZExtValue());
+            }
+        } else if (checked) {
+            array_emitter.emit_bounds_check(index_i64, ctx.builder.getInt64(*array_type->size));
+        }
+
+        return ctx.builder.CreateInBoundsGEP(
+                array_val,
+                (val [2]){
+                    ctx.builder.getInt64(0u),
+                    index_i64
+                }
+            );
+    }
+
     val emit(ast::node::index_access const& access)
     {
         auto const child_type = type::type_of(access->child);
@@ -867,6 +1577,7 @@ public:
 
         } else if (auto const maybe_array_type = type::get<type::array_type>(child_type)) {
             assert(index_val->getType()->isIntegerTy());
+            auto const& array_type = *maybe_array_type;
 
             if (constant_index && !ty->isPointerTy()) {
                 auto const idx = constant_index->getZExtValue();
@@ -878,16 +1589,15 @@ public:
                 return with_check(ctx.builder.CreateExtractValue(child_val, idx));
             } else {
                 return with_check(
-                        ctx.builder.CreateInBoundsGEP(
+                        emit_array_element_ptr(
+                            access,
+                            array_type,
                             ty->isPointerTy() ?
                                 child_val :
-                                get_ir_helper(access).alloc_and_deep_copy(child_val),
-                            (val [2]){
-                                ctx.builder.getInt32(0u),
-                                index_val->getType()->isIntegerTy(32u) ?
-                                    index_val :
-                                    ctx.builder.CreateIntCast(index_val, ctx.builder.getInt32Ty(), true)
-                            }
+                                // Note:
+                                // The array value is a temporary.  Only its address is needed.
+                                get_ir_helper(access).alloc_and_move(child_val),
+                            index_val
                         )
                     );
             }
@@ -910,9 +1620,20 @@ public:
 
             if (func->is_anonymous()) {
                 auto const& capture = semantics_ctx.lambda_captures.at(func).get<semantics::tags::introduced>().find(ufcs);
-                return child_val->getType()->isStructTy() ?
+                auto const is_struct_value = child_val->getType()->isStructTy();
+                auto *const field = is_struct_value ?
                     ctx.builder.CreateExtractValue(child_val, capture->offset) :
                     ctx.builder.CreateStructGEP(child_val, capture->offset);
+
+                if (!semantics::is_captured_by_reference(semantics_ctx.non_escaping_lambdas, func, *capture)) {
+                    return field;
+                }
+
+                // Note:
+                // The field is a pointer to the captured variable
+                auto *const captured_ref = is_struct_value ? field : ctx.builder.CreateLoad(field, "capture.ref");
+                captured_references.insert(captured_ref);
+                return captured_ref;
             }
         }
 
@@ -956,11 +1677,14 @@ public:
             assert(ufcs->do_block_object);
             args.push_back(get_operand(emit(*ufcs->do_block_object)));
 
+            mark_do_block_for_inlining(*ufcs->do_block, callee);
+
             // Note:
             // Add block to the 2nd argument of invocation as function variable
             return check(
                         ufcs,
-                        ctx.builder.CreateCall(
+                        emit_call(
+                            callee,
                             emit_non_builtin_callee(ufcs, callee),
                             args
                         ),
@@ -970,7 +1694,8 @@ public:
 
         return check(
                     ufcs,
-                    ctx.builder.CreateCall(
+                    emit_call(
+                        callee,
                         emit_callee(ufcs, callee, std::vector<ast::node::any_expr>{{ufcs->child}}),
                         args
                     ),
@@ -997,28 +1722,130 @@ public:
         helper.terminate_with_br(cond_block, exit_block);
     }
 
+    // Note:
+    // A loop over a range is lowered to a counted loop.  No array is materialized.
+    // The counter never wraps because it is compared with the end before incremented.
+    // So the increment is marked as non-wrapping and the trip count is computable by
+    // LLVM's loop optimizations.
+    //   exclusive: for (i = begin; i < end; ++i) body
+    //   inclusive: if (begin <= end) for (i = begin; ; ++i) { body; if (i == end) break; }
+    void emit_counted_for(ast::node::for_stmt const& for_, type::range_type const& range_type)
+    {
+        auto helper = get_ir_helper(for_);
+
+        if (for_->iter_vars.size() != 1u) {
+            DACHS_RAISE_INTERNAL_COMPILATION_ERROR
+        }
+
+        auto *const range_val = get_operand(emit(for_->range_expr));
+        auto *const counter_type = type_emitter.emit(range_type->element_type);
+        auto const is_unsigned = type::type{range_type->element_type}.is_builtin("uint");
+        auto *const begin_val = ctx.builder.CreateExtractValue(range_val, 0u, "for.begin");
+        auto *const end_val = ctx.builder.CreateExtractValue(range_val, 1u, "for.end");
+
+        auto const& param = for_->iter_vars[0];
+        auto const sym = param->param_symbol;
+        auto *const counter_val = helper.create_alloca_in_entry_block(counter_type, "for.i");
+        ctx.builder.CreateStore(begin_val, counter_val);
+        auto *const allocated =
+            param->is_var ? helper.create_alloca_in_entry_block(counter_type, param->name) : nullptr;
+
+        auto *const header_block = range_type->is_inclusive ? nullptr : helper.create_block_for_parent("for.header");
+        auto *const body_block = helper.create_block_for_parent("for.body");
+        auto *const latch_block = range_type->is_inclusive ? helper.create_block_for_parent("for.latch") : nullptr;
+        auto *const footer_block = helper.create_block_for_parent("for.footer");
+
+        auto const less_than
+            = [&, this](val const lhs, val const rhs)
+            {
+                return is_unsigned ? ctx.builder.CreateICmpULT(lhs, rhs) : ctx.builder.CreateICmpSLT(lhs, rhs);
+            };
+
+        if (range_type->is_inclusive) {
+            helper.create_cond_br(ctx.builder.CreateNot(less_than(end_val, begin_val)), body_block, footer_block);
+        } else {
+            helper.create_br(header_block);
+            helper.create_cond_br(less_than(ctx.builder.CreateLoad(counter_val), end_val), body_block, footer_block);
+        }
+
+        auto *const loaded_counter_val = ctx.builder.CreateLoad(counter_val, "for.i.loaded");
+
+        if (param->name != "_" || !sym.expired()) {
+            if (allocated) {
+                ctx.builder.CreateStore(loaded_counter_val, allocated);
+                var_table.insert(sym.lock(), allocated);
+            } else {
+                var_table.insert(sym.lock(), loaded_counter_val);
+                loaded_counter_val->setName(param->name);
+            }
+        }
+
+        emit(for_->body_stmts);
+
+        if (range_type->is_inclusive) {
+            helper.create_cond_br(ctx.builder.CreateICmpEQ(loaded_counter_val, end_val), footer_block, latch_block);
+            ctx.builder.SetInsertPoint(latch_block);
+        }
+
+        auto *const one = llvm::ConstantInt::get(counter_type, 1u);
+        ctx.builder.CreateStore(
+                is_unsigned ?
+                    ctx.builder.CreateNUWAdd(loaded_counter_val, one, "for.i.next") :
+                    ctx.builder.CreateNSWAdd(loaded_counter_val, one, "for.i.next"),
+                counter_val
+            );
+        helper.create_br(range_type->is_inclusive ? body_block : header_block, footer_block);
+    }
+
     void emit(ast::node::for_stmt const& for_)
     {
+        if (auto const maybe_range_type = type::get<type::range_type>(type::type_of(for_->range_expr))) {
+            emit_counted_for(for_, *maybe_range_type);
+            return;
+        }
+
         auto helper = get_ir_helper(for_);
 
         // Note:
         // Now array is only supported
 
+        auto const maybe_array_type = type::get<type::array_type>(type::type_of(for_->range_expr));
+        auto const is_dynamic_range = maybe_array_type && !(*maybe_array_type)->size;
+
         val range_val = emit(for_->range_expr);
-        if (!range_val->getType()->isPointerTy()) {
-            if (auto *const a = llvm::dyn_cast<llvm::ConstantArray>(range_val)) {
-                range_val = new llvm::GlobalVariable(*module, a->getType(), true, llvm::GlobalVariable::PrivateLinkage, a);
-            } else {
-                range_val = helper.alloc_and_deep_copy(range_val);
+        bool owns_range = false;
+        val range_size_val = nullptr;
+        llvm::Type *counter_type = nullptr;
+
+        if (is_dynamic_range) {
+            // Note:
+            // The length is evaluated once before the loop.  The data pointer is reloaded
+            // in each iteration because pushing elements in the loop may reallocate it.
+            range_val = get_operand(range_val);
+            range_size_val = dynamic_array::emit_length(ctx, range_val);
+            counter_type = ctx.builder.getInt64Ty();
+        } else {
+            owns_range = llvm::isa<llvm::AllocaInst>(range_val) && is_movable(for_->range_expr);
+            if (!range_val->getType()->isPointerTy()) {
+                if (auto *const a = llvm::dyn_cast<llvm::ConstantArray>(range_val)) {
+                    range_val = new llvm::GlobalVariable(*module, a->getType(), true, llvm::GlobalVariable::PrivateLinkage, a);
+                } else {
+                    // Note:
+                    // The range value is a temporary.  So it is not copied deeply.
+                    range_val = helper.alloc_and_move(range_val);
+                    owns_range = !refers_other_memory(type::type_of(for_->range_expr));
+                }
             }
-        }
 
-        assert(range_val->getType()->isPointerTy());
-        assert(range_val->getType()->getPointerElementType()->isArrayTy());
+            assert(range_val->getType()->isPointerTy());
+            assert(range_val->getType()->getPointerElementType()->isArrayTy());
+
+            range_size_val = ctx.builder.getInt32(range_val->getType()->getPointerElementType()->getArrayNumElements());
+            counter_type = ctx.builder.getInt32Ty();
+        }
 
-        auto *const range_size_val = ctx.builder.getInt32(range_val->getType()->getPointerElementType()->getArrayNumElements());
-        auto *const counter_val = ctx.builder.CreateAlloca(ctx.builder.getInt32Ty(), nullptr, "for.i");
-        ctx.builder.CreateStore(ctx.builder.getInt32(0u), counter_val);
+        auto *const counter_val = helper.create_alloca_in_entry_block(counter_type, "for.i");
+        ctx.builder.CreateStore(llvm::ConstantInt::get(counter_type, 0u), counter_val);
 
         if (for_->iter_vars.size() != 1u) {
             DACHS_RAISE_INTERNAL_COMPILATION_ERROR
@@ -1027,8 +1854,11 @@ public:
         auto const& param = for_->iter_vars[0];
         auto const sym = param->param_symbol;
         auto const iter_t = type_emitter.emit(param->type);
+        // Note:
+        // When the range is owned by the loop, elements of it are moved to the mutable iteration variable.
+        // Elements of a dynamic array are always copied because the buffer may be reallocated in the loop.
         auto *const allocated =
-            param->is_var ? ctx.builder.CreateAlloca(iter_t, nullptr, param->name) : nullptr;
+            (param->is_var && !owns_range) || is_dynamic_range ? helper.create_alloca_in_entry_block(iter_t, param->name) : nullptr;
 
         // Note:
         // Do not emit parameter by emit(ast::node::parameter const&)
@@ -1051,17 +1881,27 @@ public:
 
         if (param->name != "_" || !sym.expired()) {
             auto *const elem_ptr_val =
-                ctx.builder.CreateInBoundsGEP(
-                    range_val,
-                    (val [2]){
-                        ctx.builder.getInt32(0u),
-                        loaded_counter_val
-                    },
-                    param->name
-                );
+                is_dynamic_range ?
+                    ctx.builder.CreateInBoundsGEP(
+                        dynamic_array::emit_data(ctx, range_val, iter_t),
+                        loaded_counter_val,
+                        param->name
+                    ) :
+                    ctx.builder.CreateInBoundsGEP(
+                        range_val,
+                        (val [2]){
+                            ctx.builder.getInt32(0u),
+                            loaded_counter_val
+                        },
+                        param->name
+                    );
 
             if (allocated) {
-                helper.create_deep_copy(elem_ptr_val, allocated);
+                if (param->is_var) {
+                    helper.create_deep_copy(elem_ptr_val, allocated);
+                } else {
+                    helper.create_move(elem_ptr_val, allocated);
+                }
                 var_table.insert(sym.lock(), allocated);
             } else {
                 var_table.insert(sym.lock(), elem_ptr_val);
@@ -1071,7 +1911,7 @@ public:
 
         emit(for_->body_stmts);
 
-        ctx.builder.CreateStore(ctx.builder.CreateAdd(loaded_counter_val, ctx.builder.getInt32(1u)), counter_val);
+        ctx.builder.CreateStore(ctx.builder.CreateAdd(loaded_counter_val, llvm::ConstantInt::get(counter_type, 1u)), counter_val);
         helper.create_br(header_block, footer_block);
     }
 
@@ -1083,13 +1923,14 @@ public:
                 auto const sym = d->symbol.lock();
                 assert(d->maybe_type);
                 auto const type_ir = type_emitter.emit(sym->type);
-                auto *const allocated = ctx.builder.CreateAlloca(type_ir, nullptr, sym->name);
+                auto *const allocated = create_alloca_in_entry_block(ctx, type_ir, sym->name);
                 ctx.builder.CreateMemSet(
                         allocated,
                         ctx.builder.getInt8(0u),
                         ctx.data_layout->getTypeAllocSize(type_ir),
                         ctx.data_layout->getPrefTypeAlignment(type_ir)
                     );
+                declare_debug_variable(sym, allocated, d);
                 var_table.insert(std::move(sym), allocated);
             }
             return;
@@ -1115,18 +1956,44 @@ public:
                 auto const sym = decl->symbol.lock();
                 if (decl->is_var) {
                     auto *const allocated = helper.alloc_and_deep_copy(value, sym->name);
+                    declare_debug_variable(sym, allocated, decl);
                     var_table.insert(std::move(sym), allocated);
                 } else {
                     // If the variable is immutable, do not copy rhs value
+                    declare_debug_variable(sym, value, decl);
                     var_table.insert(std::move(sym), value);
                 }
             };
 
+        // Note:
+        // A mutable variable takes over the memory of the moved value instead of copying it.
+        auto const initialize_by_move
+            = [&, this](auto const& decl, auto *const value)
+            {
+                auto *const allocated = llvm::dyn_cast<llvm::AllocaInst>(value);
+                if (!decl->is_var || decl->symbol.expired() || !allocated) {
+                    return false;
+                }
+
+                allocated->setName(decl->name);
+                declare_debug_variable(decl->symbol.lock(), allocated, decl);
+                var_table.insert(decl->symbol.lock(), allocated);
+                return true;
+            };
+
         if (initializee_size == initializer_size) {
             helper::each(
                     [&, this](auto const& d, auto const& e)
                     {
-                        initialize(d, emit(e));
+                        auto *const value = emit(e);
+                        if (!is_movable(e) || !initialize_by_move(d, value)) {
+                            initialize(
+                                    d,
+                                    !d->is_var && refers_dynamic_array_element(e) ?
+                                        helper.alloc_and_move(value, d->name) :
+                                        value
+                                );
+                        }
                     }
                     , init->var_decls, rhs_exprs
                 );
@@ -1136,7 +2003,11 @@ public:
             auto *const rhs_tuple_value
                 = emit_tuple_constant(rhs_exprs);
 
-            initialize(init->var_decls[0], rhs_tuple_value);
+            auto const is_temporary_movable
+                = all_of(rhs_exprs, [](auto const& e){ return !refers_other_memory(type::type_of(e)); });
+            if (!is_temporary_movable || !initialize_by_move(init->var_decls[0], rhs_tuple_value)) {
+                initialize(init->var_decls[0], rhs_tuple_value);
+            }
         } else if (initializer_size == 1) {
             assert(initializee_size > 1);
             auto const& rhs_expr = (rhs_exprs)[0];
@@ -1178,6 +2049,7 @@ public:
 
         // Load rhs value
         std::vector<val> rhs_values;
+        std::vector<bool> rhs_movables;
 
         auto const assignee_size = assign->assignees.size();
         auto const assigner_size = assign->rhs_exprs.size();
@@ -1192,6 +2064,7 @@ public:
                             error(assign, "Binary expression now only supports float, int, bool and uint");
                         }
                         rhs_values.push_back(emit(rhs));
+                        rhs_movables.push_back(!is_compound_assign && is_movable(rhs));
                     }, assign->assignees, assign->rhs_exprs);
         } else if (assigner_size == 1) {
             assert(assignee_size > 1);
@@ -1201,12 +2074,15 @@ public:
 
             for (auto const idx : boost::irange(0u, rhs_struct_type->getNumElements())) {
                 rhs_values.push_back(ctx.builder.CreateLoad(ctx.builder.CreateStructGEP(rhs_value, idx)));
+                rhs_movables.push_back(false);
             }
         } else {
             DACHS_RAISE_INTERNAL_COMPILATION_ERROR
         }
 
         assert(assignee_size == rhs_values.size());
+        assert(assignee_size == rhs_movables.size());
+        auto rhs_movable_itr = std::begin(rhs_movables);
 
         auto const assignment_emitter =
             [&, this](auto const& lhs_expr, auto *const rhs_value)
@@ -1240,7 +2116,11 @@ public:
                         );
                 }
 
-                helper.create_deep_copy(value_to_assign, lhs_value);
+                if (*rhs_movable_itr++) {
+                    helper.create_move(value_to_assign, lhs_value);
+                } else {
+                    helper.create_deep_copy(value_to_assign, lhs_value);
+                }
             };
 
         helper::each(assignment_emitter, assign->assignees, rhs_values);
@@ -1289,7 +2169,7 @@ public:
      *   br lend
      *   lelse:
      */
-    void emit(ast::node::switch_stmt const& switch_)
+    void emit_compare_chain_switch(ast::node::switch_stmt const& switch_)
     {
         auto helper = get_ir_helper(switch_);
         auto *const end_block = helper.create_block("switch.end");
@@ -1346,6 +2226,231 @@ public:
         helper.append_block(end_block);
     }
 
+    bool is_integral_switch_type(type::type const& t) const
+    {
+        auto const builtin = type::get<type::builtin_type>(t);
+        if (!builtin) {
+            return false;
+        }
+        auto const& name = (*builtin)->name;
+        return name == "int" || name == "uint" || name == "char" || name == "bool";
+    }
+
+    bool is_string_switch_type(type::type const& t) const
+    {
+        auto const builtin = type::get<type::builtin_type>(t);
+        return builtin && ((*builtin)->name == "string" || (*builtin)->name == "symbol");
+    }
+
+    // Note:
+    // Literals (and negated literals) are emitted as constants without any instruction
+    bool is_integral_label(ast::node::any_expr const& e) const
+    {
+        if (auto const unary = get_as<ast::node::unary_expr>(e)) {
+            return (*unary)->op == "-" && is_integral_label((*unary)->expr);
+        }
+
+        auto const lit = get_as<ast::node::primary_literal>(e);
+        return lit
+            && !boost::get<std::string>(&(*lit)->value)
+            && !boost::get<double>(&(*lit)->value);
+    }
+
+    boost::optional<std::string> get_string_label(ast::node::any_expr const& e) const
+    {
+        if (auto const lit = get_as<ast::node::primary_literal>(e)) {
+            if (auto const str = boost::get<std::string>(&(*lit)->value)) {
+                return *str;
+            }
+        } else if (auto const sym = get_as<ast::node::symbol_literal>(e)) {
+            return (*sym)->value;
+        }
+        return boost::none;
+    }
+
+    void emit_switch_bodies(ast::node::switch_stmt const& switch_, std::vector<llvm::BasicBlock *> const& then_blocks, llvm::BasicBlock *const else_block, llvm::BasicBlock *const end_block)
+    {
+        auto helper = get_ir_helper(switch_);
+
+        for (auto const idx : helper::indices(switch_->when_stmts_list.size())) {
+            helper.append_block(then_blocks[idx]);
+            emit(switch_->when_stmts_list[idx].second);
+            helper.terminate_with_br(end_block);
+        }
+
+        helper.append_block(else_block);
+        if (switch_->maybe_else_stmts) {
+            emit(*switch_->maybe_else_stmts);
+        }
+        helper.terminate_with_br(end_block);
+
+        helper.append_block(end_block);
+    }
+
+    /*
+     * - statement
+     *   case v
+     *   when 1, 2
+     *   when 3
+     *   else
+     *   end
+     *
+     * - IR
+     *   switch v, lelse [1, lthen1], [2, lthen1], [3, lthen2]
+     *
+     * Labels which already appeared in former 'when' clauses are never matched.
+     * The backend lowers the switch to a jump table or a binary search.
+     */
+    void emit_switch_inst(ast::node::switch_stmt const& switch_)
+    {
+        auto helper = get_ir_helper(switch_);
+        auto *const end_block = helper.create_block("switch.end");
+        auto *const else_block = helper.create_block("switch.else");
+
+        auto *const target_val = get_operand(emit(switch_->target_expr));
+
+        std::vector<llvm::BasicBlock *> then_blocks;
+        std::vector<std::pair<llvm::ConstantInt *, llvm::BasicBlock *>> cases;
+        std::unordered_set<std::uint64_t> appeared_labels;
+        for (auto const& when_stmt : switch_->when_stmts_list) {
+            auto *const then_block = helper.create_block("switch.then");
+            then_blocks.push_back(then_block);
+
+            for (auto const& cmp_expr : when_stmt.first) {
+                auto *const label = llvm::dyn_cast<llvm::ConstantInt>(get_operand(emit(cmp_expr)));
+                if (!label || label->getType() != target_val->getType()) {
+                    error(switch_, "Label of switch statement must be a constant of the target type");
+                }
+
+                if (appeared_labels.insert(label->getZExtValue()).second) {
+                    cases.emplace_back(label, then_block);
+                }
+            }
+        }
+
+        auto *const switch_inst = check(switch_, ctx.builder.CreateSwitch(target_val, else_block, cases.size()), "switch instruction");
+        for (auto const& c : cases) {
+            switch_inst->addCase(c.first, c.second);
+        }
+
+        emit_switch_bodies(switch_, then_blocks, else_block, end_block);
+    }
+
+    /*
+     * - statement
+     *   case s
+     *   when "foo", "bar"
+     *   else
+     *   end
+     *
+     * - IR
+     *   %hash = call @__dachs_string_hash__(s, seed)
+     *   %slot = and %hash, (num_slots - 1)
+     *   switch %slot, lelse [slot("foo"), lfoo], [slot("bar"), lbar]
+     *   lfoo:
+     *   strcmp(s, "foo") == 0 ? br lthen : br lelse
+     *   lbar:
+     *   strcmp(s, "bar") == 0 ? br lthen : br lelse
+     *
+     * Seed is chosen at compile time so that each slot has one label if possible.
+     * See perfect_hash.hpp.
+     */
+    void emit_hashed_string_switch(ast::node::switch_stmt const& switch_)
+    {
+        auto helper = get_ir_helper(switch_);
+        auto *const end_block = helper.create_block("switch.end");
+        auto *const else_block = helper.create_block("switch.else");
+
+        auto *const target_val = get_operand(emit(switch_->target_expr));
+
+        std::vector<llvm::BasicBlock *> then_blocks;
+        std::vector<std::string> labels;
+        std::vector<llvm::BasicBlock *> label_dests;
+        for (auto const& when_stmt : switch_->when_stmts_list) {
+            auto *const then_block = helper.create_block("switch.then");
+            then_blocks.push_back(then_block);
+
+            for (auto const& cmp_expr : when_stmt.first) {
+                auto const label = *get_string_label(cmp_expr);
+                if (std::find(std::begin(labels), std::end(labels), label) == std::end(labels)) {
+                    labels.push_back(label);
+                    label_dests.push_back(then_block);
+                }
+            }
+        }
+
+        detail::perfect_hash_table const table{labels};
+
+        auto *const i8_ptr_type = ctx.builder.getInt8PtrTy();
+        auto *const hash_func = get_runtime_func(
+                *module,
+                "__dachs_string_hash__",
+                ctx.builder.getInt64Ty(),
+                {i8_ptr_type, ctx.builder.getInt64Ty()},
+                {llvm::Attribute::ReadOnly}
+            );
+        auto *const strcmp_func = get_runtime_func(
+                *module,
+                "strcmp",
+                ctx.builder.getInt32Ty(),
+                {i8_ptr_type, i8_ptr_type},
+                {llvm::Attribute::ReadOnly}
+            );
+
+        auto *const hash_val = ctx.builder.CreateCall2(hash_func, target_val, ctx.builder.getInt64(table.seed), "switch.hash");
+        auto *const slot_val = ctx.builder.CreateAnd(hash_val, table.num_slots - 1u, "switch.slot");
+        auto *const switch_inst = check(switch_, ctx.builder.CreateSwitch(slot_val, else_block, labels.size()), "switch instruction");
+
+        for (auto const slot_idx : helper::indices(table.slots.size())) {
+            auto const& slot = table.slots[slot_idx];
+            if (slot.empty()) {
+                continue;
+            }
+
+            auto *const slot_block = helper.create_block_for_parent("switch.slot", true);
+            switch_inst->addCase(ctx.builder.getInt64(slot_idx), slot_block);
+
+            // Note:
+            // Labels in the same slot are compared in order
+            for (auto const label_idx : slot) {
+                auto *const next_block = helper.create_block_for_parent("switch.slot.next");
+                auto *const cmp_val = ctx.builder.CreateCall2(strcmp_func, target_val, ctx.builder.CreateGlobalStringPtr(labels[label_idx]));
+                helper.create_cond_br(ctx.builder.CreateICmpEQ(cmp_val, ctx.builder.getInt32(0)), label_dests[label_idx], next_block, next_block);
+            }
+            helper.create_br(else_block, nullptr);
+        }
+
+        emit_switch_bodies(switch_, then_blocks, else_block, end_block);
+    }
+
+    // Note:
+    // Switch statements whose labels are all literals are dispatched in constant time.
+    // Integers, chars and bools are lowered to LLVM switch instruction.  Strings and
+    // symbols are dispatched with the perfect hash of labels.  Others are lowered to
+    // a chain of comparisons.
+    void emit(ast::node::switch_stmt const& switch_)
+    {
+        auto const target_type = type::type_of(switch_->target_expr);
+        auto const all_labels_are
+            = [&switch_](auto const& pred)
+            {
+                return all_of(
+                        switch_->when_stmts_list,
+                        [&pred](auto const& when_stmt){ return all_of(when_stmt.first, pred); }
+                    );
+            };
+
+        if (is_integral_switch_type(target_type)
+                && all_labels_are([this](auto const& e){ return is_integral_label(e); })) {
+            emit_switch_inst(switch_);
+        } else if (is_string_switch_type(target_type)
+                && all_labels_are([this](auto const& e){ return static_cast<bool>(get_string_label(e)); })) {
+            emit_hashed_string_switch(switch_);
+        } else {
+            emit_compare_chain_switch(switch_);
+        }
+    }
+
     val emit(ast::node::if_expr const& if_)
     {
         auto helper = get_ir_helper(if_);
@@ -1482,6 +2587,22 @@ public:
             arg_vals.push_back(get_operand(emit(e)));
         }
 
+        if (auto const maybe_array_type = type::get<type::array_type>(obj->type)) {
+            auto const& array_type = *maybe_array_type;
+            if (!array_type->size) {
+                assert(arg_vals.size() == 1u || arg_vals.size() == 2u);
+                return check(
+                        obj,
+                        array_emitter.emit_new(
+                            type_emitter.emit(array_type->element_type),
+                            arg_vals[0],
+                            arg_vals.size() == 2u ? arg_vals[1] : nullptr
+                        ),
+                        "dynamic array construction"
+                    );
+            }
+        }
+
         return check(obj, ctor_emitter.emit(obj->type, arg_vals), "object construction");
     }
 
@@ -0,0 +1,157 @@
+#if !defined DACHS_CODEGEN_LLVMIR_NAME_MANGLER_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_NAME_MANGLER_HPP_INCLUDED
+
+#include <string>
+
+#include "dachs/semantics/type.hpp"
+#include "dachs/semantics/scope.hpp"
+#include "dachs/helper/variant.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+namespace detail {
+
+// Note:
+// Mangles a function scope into a compact symbol name.
+//   _D <length of name> <name> <parameter types>
+// e.g. 'func foo(int, [float])' is '_D3fooiAd'.
+// Types are encoded as below.
+//   int:i  uint:j  float:d  char:c  bool:b  string:s  symbol:y
+//   tuple:T...E  array:A<size>_T  dynamic array:A_T  range:R<i|e>T  dict:HKV
+//   func:F...E<ret>  proc:P...E  generic function:G<length><name>
+//   class:C<length><name>  maybe:MT  template:X
+// The result only depends on the signature.  So it is stable among compilations.
+class name_mangler {
+    std::string result;
+
+    void mangle_name(std::string const& name)
+    {
+        result += std::to_string(name.size());
+        result += name;
+    }
+
+    template<class Types>
+    void mangle_types(Types const& ts)
+    {
+        for (auto const& t : ts) {
+            mangle(t);
+        }
+    }
+
+    void mangle(type::builtin_type const& t)
+    {
+        auto const& n = t->name;
+        result += n == "int"    ? "i"
+                : n == "uint"   ? "j"
+                : n == "float"  ? "d"
+                : n == "char"   ? "c"
+                : n == "bool"   ? "b"
+                : n == "string" ? "s"
+                : n == "symbol" ? "y"
+                : "U" + std::to_string(n.size()) + n;
+    }
+
+    void mangle(type::class_type const& t)
+    {
+        result += 'C';
+        mangle_name(t->name);
+    }
+
+    void mangle(type::tuple_type const& t)
+    {
+        result += 'T';
+        mangle_types(t->element_types);
+        result += 'E';
+    }
+
+    void mangle(type::func_type const& t)
+    {
+        result += 'F';
+        mangle_types(t->param_types);
+        result += 'E';
+        mangle(t->return_type);
+    }
+
+    void mangle(type::proc_type const& t)
+    {
+        result += 'P';
+        mangle_types(t->param_types);
+        result += 'E';
+    }
+
+    void mangle(type::generic_func_type const& t)
+    {
+        result += 'G';
+        if (t->ref && !t->ref->expired()) {
+            mangle_name(t->ref->lock()->name);
+        } else {
+            result += '0';
+        }
+    }
+
+    void mangle(type::dict_type const& t)
+    {
+        result += 'H';
+        mangle(t->key_type);
+        mangle(t->value_type);
+    }
+
+    void mangle(type::array_type const& t)
+    {
+        result += 'A';
+        if (t->size) {
+            result += std::to_string(*t->size);
+        }
+        result += '_';
+        mangle(t->element_type);
+    }
+
+    void mangle(type::range_type const& t)
+    {
+        result += 'R';
+        result += t->is_inclusive ? 'i' : 'e';
+        mangle(t->element_type);
+    }
+
+    void mangle(type::qualified_type const& t)
+    {
+        result += 'M';
+        mangle(t->contained_type);
+    }
+
+    void mangle(type::template_type const&)
+    {
+        result += 'X';
+    }
+
+    void mangle(type::type const& t)
+    {
+        helper::variant::apply_lambda([this](auto const& t){ mangle(t); }, t.raw_value());
+    }
+
+public:
+
+    std::string mangle(scope::func_scope const& scope)
+    {
+        result = "_D";
+        mangle_name(scope->name);
+        for (auto const& p : scope->params) {
+            mangle(p->type);
+        }
+        return result;
+    }
+};
+
+} // namespace detail
+
+inline std::string mangle(scope::func_scope const& scope)
+{
+    return detail::name_mangler{}.mangle(scope);
+}
+
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_NAME_MANGLER_HPP_INCLUDED
@@ -0,0 +1,93 @@
+#if !defined DACHS_CODEGEN_LLVMIR_PERFECT_HASH_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_PERFECT_HASH_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+namespace detail {
+
+// Note:
+// 64bit FNV-1a with seed.  Upper bits are folded into lower bits because slots are
+// chosen by lower bits.
+// This MUST be the same as __dachs_string_hash__() in dachs/runtime/string.cpp
+inline std::uint64_t string_hash(std::string const& s, std::uint64_t const seed) noexcept
+{
+    std::uint64_t h = 14695981039346656037ull ^ seed;
+    for (unsigned char const c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h ^ (h >> 32);
+}
+
+// Note:
+// Hash table of string labels of switch statement built at compile time.
+// The seed which minimizes the number of keys in the most crowded slot is chosen from
+// 'max_seeds' candidates.  Usually each slot has at most one key (perfect hash).  When
+// no perfect hash is found, keys in the same slot are compared in order.
+class perfect_hash_table {
+    static constexpr std::uint64_t max_seeds = 256u;
+
+    static std::uint64_t slots_for(std::size_t const num_keys) noexcept
+    {
+        // Note:
+        // Load factor is at most 1/2
+        std::uint64_t n = 1u;
+        while (n < num_keys * 2u) {
+            n <<= 1;
+        }
+        return n;
+    }
+
+    std::size_t max_load_of(std::vector<std::string> const& keys, std::uint64_t const s) const
+    {
+        std::vector<std::size_t> loads(num_slots, 0u);
+        std::size_t max_load = 0u;
+        for (auto const& k : keys) {
+            max_load = std::max(max_load, ++loads[string_hash(k, s) & (num_slots - 1u)]);
+        }
+        return max_load;
+    }
+
+public:
+
+    std::uint64_t seed = 0u;
+    std::uint64_t num_slots; // Power of 2
+    std::vector<std::vector<std::size_t>> slots; // Indices of keys in each slot
+
+    explicit perfect_hash_table(std::vector<std::string> const& keys)
+        : num_slots(slots_for(keys.size()))
+    {
+        auto min_load = max_load_of(keys, seed);
+        for (std::uint64_t s = 1u; s < max_seeds && min_load > 1u; ++s) {
+            auto const load = max_load_of(keys, s);
+            if (load < min_load) {
+                min_load = load;
+                seed = s;
+            }
+        }
+
+        slots.resize(num_slots);
+        for (std::size_t idx = 0u; idx < keys.size(); ++idx) {
+            slots[slot_of(keys[idx])].push_back(idx);
+        }
+    }
+
+    std::uint64_t slot_of(std::string const& key) const noexcept
+    {
+        return string_hash(key, seed) & (num_slots - 1u);
+    }
+};
+
+} // namespace detail
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_PERFECT_HASH_HPP_INCLUDED
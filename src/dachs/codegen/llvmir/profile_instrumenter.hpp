@@ -0,0 +1,426 @@
+#if !defined DACHS_CODEGEN_LLVMIR_PROFILE_INSTRUMENTER_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_PROFILE_INSTRUMENTER_HPP_INCLUDED
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cassert>
+
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+#include "dachs/codegen/llvmir/context.hpp"
+#include "dachs/codegen/llvmir/perfect_hash.hpp"
+#include "dachs/exception.hpp"
+#include "dachs/warning.hpp"
+#include "dachs/helper/util.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+namespace detail {
+
+// Note:
+// Probe points of profile-guided optimization are function entries and all edges of
+// conditional branches and switches.  They are enumerated from the emitted IR in the same
+// order in instrumented build (--profile-generate) and optimized build (--profile-use).
+// Because IR emission is deterministic, the keys below identify the same points in both builds.
+//   {function}:entry
+//   {function}:br{index of the branch}:{index of the successor}
+//   {function}:sw{index of the switch}:{index of the successor}
+// Successor 0 of a switch is its default destination.
+// The checksum of the CFG of each function is recorded with the key '{function}:checksum'.
+// When the function is modified after the profile was taken, the checksum doesn't match
+// and the counts of the function are not used.
+class profile_probe_points {
+public:
+
+    struct entry {
+        llvm::Function *function;
+        std::string key;
+        std::string checksum_key;
+        std::uint64_t checksum;
+    };
+
+    struct edge {
+        llvm::TerminatorInst *terminator;
+        unsigned successor;
+        std::string key;
+    };
+
+    std::vector<entry> entries;
+    std::vector<edge> edges;
+
+private:
+
+    // Note:
+    // The checksum reflects the kind and the number of successors of each terminator.
+    // Adding or removing a branch changes the keys of following probe points.
+    static std::uint64_t cfg_checksum(llvm::Function const& f)
+    {
+        std::string signature;
+        for (auto const& b : f) {
+            auto const* const terminator = b.getTerminator();
+            signature += std::to_string(terminator->getOpcode()) + ':' + std::to_string(terminator->getNumSuccessors()) + ';';
+        }
+        return string_hash(signature, 0u);
+    }
+
+    void add_edges(llvm::TerminatorInst *const terminator, char const* const kind, std::string const& func_name, std::size_t const idx)
+    {
+        for (unsigned s = 0u; s < terminator->getNumSuccessors(); ++s) {
+            edges.push_back({terminator, s, (boost::format("%1%:%2%%3%:%4%") % func_name % kind % idx % s).str()});
+        }
+    }
+
+public:
+
+    explicit profile_probe_points(llvm::Module &module)
+    {
+        for (auto &f : module) {
+            if (f.isDeclaration()) {
+                continue;
+            }
+
+            auto const name = f.getName().str();
+            entries.push_back({&f, name + ":entry", name + ":checksum", cfg_checksum(f)});
+
+            std::size_t branch_idx = 0u;
+            std::size_t switch_idx = 0u;
+            for (auto &b : f) {
+                auto *const terminator = b.getTerminator();
+                if (auto *const br = llvm::dyn_cast<llvm::BranchInst>(terminator)) {
+                    if (br->isConditional()) {
+                        add_edges(br, "br", name, branch_idx++);
+                    }
+                } else if (auto *const sw = llvm::dyn_cast<llvm::SwitchInst>(terminator)) {
+                    add_edges(sw, "sw", name, switch_idx++);
+                }
+            }
+        }
+    }
+
+    // Note:
+    // Each function has a counter of its entry and a slot of its checksum.
+    std::size_t size() const noexcept
+    {
+        return entries.size() * 2u + edges.size();
+    }
+};
+
+// Note:
+// Inserts 64bit counters into function entries and edges of conditional branches and switches.
+// Edges are split to count them.  Counters are registered to libdachs by the module
+// constructor and written to the profile file at exit.  Checksums are put in the slots
+// which are never incremented so that they are written with the counts.
+class profile_instrumenter {
+    context &ctx;
+    llvm::Module &module;
+
+    static void emit_increment(llvm::IRBuilder<> &builder, llvm::GlobalVariable *const counters, std::size_t const idx)
+    {
+        auto *const counter_ptr = builder.CreateConstInBoundsGEP2_64(counters, 0u, idx);
+        builder.CreateStore(builder.CreateAdd(builder.CreateLoad(counter_ptr), builder.getInt64(1u)), counter_ptr);
+    }
+
+    void count_entry(llvm::Function &f, llvm::GlobalVariable *const counters, std::size_t const idx)
+    {
+        // Note:
+        // Allocas must be kept at the beginning of the entry block
+        auto &entry = f.getEntryBlock();
+        auto insert_point = entry.begin();
+        while (llvm::isa<llvm::AllocaInst>(*insert_point)) {
+            ++insert_point;
+        }
+
+        llvm::IRBuilder<> builder{&entry, insert_point};
+        emit_increment(builder, counters, idx);
+    }
+
+    void count_edge(profile_probe_points::edge const& e, llvm::GlobalVariable *const counters, std::size_t const idx)
+    {
+        auto *const from = e.terminator->getParent();
+        auto *const to = e.terminator->getSuccessor(e.successor);
+        auto *const edge_block = llvm::BasicBlock::Create(ctx.llvm_context, "prof.edge", from->getParent());
+
+        llvm::IRBuilder<> builder{edge_block};
+        emit_increment(builder, counters, idx);
+        builder.CreateBr(to);
+
+        e.terminator->setSuccessor(e.successor, edge_block);
+        for (auto itr = to->begin(); auto *const phi = llvm::dyn_cast<llvm::PHINode>(&*itr); ++itr) {
+            auto const incoming_idx = phi->getBasicBlockIndex(from);
+            if (incoming_idx >= 0) {
+                phi->setIncomingBlock(incoming_idx, edge_block);
+            }
+        }
+    }
+
+    llvm::Constant *emit_key(std::string const& key)
+    {
+        auto *const str = llvm::ConstantDataArray::getString(ctx.llvm_context, key);
+        auto *const global = new llvm::GlobalVariable(module, str->getType(), true, llvm::GlobalVariable::PrivateLinkage, str, "dachs.profile.key");
+        auto *const zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(ctx.llvm_context), 0u);
+        return llvm::ConstantExpr::getInBoundsGetElementPtr(global, std::vector<llvm::Constant *>{zero, zero});
+    }
+
+    void emit_registration(std::vector<llvm::Constant *> const& keys, llvm::GlobalVariable *const counters)
+    {
+        auto *const i8_ptr_type = llvm::Type::getInt8PtrTy(ctx.llvm_context);
+        auto *const i64_type = llvm::Type::getInt64Ty(ctx.llvm_context);
+        auto *const keys_type = llvm::ArrayType::get(i8_ptr_type, keys.size());
+        auto *const keys_global = new llvm::GlobalVariable(
+                module,
+                keys_type,
+                true,
+                llvm::GlobalVariable::PrivateLinkage,
+                llvm::ConstantArray::get(keys_type, keys),
+                "dachs.profile.keys"
+            );
+
+        auto *const register_func = llvm::Function::Create(
+                llvm::FunctionType::get(
+                    llvm::Type::getVoidTy(ctx.llvm_context),
+                    std::vector<llvm::Type *>{i8_ptr_type->getPointerTo(), i64_type->getPointerTo(), i64_type},
+                    false
+                ),
+                llvm::Function::ExternalLinkage,
+                "__dachs_profile_register__",
+                &module
+            );
+        register_func->addFnAttr(llvm::Attribute::NoUnwind);
+
+        auto *const init_func = llvm::Function::Create(
+                llvm::FunctionType::get(llvm::Type::getVoidTy(ctx.llvm_context), false),
+                llvm::Function::InternalLinkage,
+                "dachs.profile.init",
+                &module
+            );
+        init_func->addFnAttr(llvm::Attribute::NoUnwind);
+
+        llvm::IRBuilder<> builder{llvm::BasicBlock::Create(ctx.llvm_context, "entry", init_func)};
+        builder.CreateCall3(
+                register_func,
+                builder.CreateConstInBoundsGEP2_64(keys_global, 0u, 0u),
+                builder.CreateConstInBoundsGEP2_64(counters, 0u, 0u),
+                builder.getInt64(keys.size())
+            );
+        builder.CreateRetVoid();
+
+        llvm::appendToGlobalCtors(module, init_func, 0);
+    }
+
+public:
+
+    profile_instrumenter(context &c, llvm::Module &m) noexcept
+        : ctx(c), module(m)
+    {}
+
+    void instrument()
+    {
+        // Note:
+        // Probe points are collected before the IR is modified
+        profile_probe_points const points{module};
+        if (points.size() == 0u) {
+            return;
+        }
+
+        auto *const i64_type = llvm::Type::getInt64Ty(ctx.llvm_context);
+        auto *const counters_type = llvm::ArrayType::get(i64_type, points.size());
+
+        std::vector<llvm::Constant *> initial_values(points.size(), llvm::ConstantInt::get(i64_type, 0u));
+        for (auto const i : helper::indices(points.entries.size())) {
+            initial_values[points.entries.size() + points.edges.size() + i]
+                = llvm::ConstantInt::get(i64_type, points.entries[i].checksum);
+        }
+
+        auto *const counters = new llvm::GlobalVariable(
+                module,
+                counters_type,
+                false,
+                llvm::GlobalVariable::InternalLinkage,
+                llvm::ConstantArray::get(counters_type, initial_values),
+                "dachs.profile.counters"
+            );
+
+        std::vector<llvm::Constant *> keys;
+        keys.reserve(points.size());
+
+        for (auto const& e : points.entries) {
+            count_entry(*e.function, counters, keys.size());
+            keys.push_back(emit_key(e.key));
+        }
+
+        for (auto const& e : points.edges) {
+            count_edge(e, counters, keys.size());
+            keys.push_back(emit_key(e.key));
+        }
+
+        for (auto const& e : points.entries) {
+            keys.push_back(emit_key(e.checksum_key));
+        }
+
+        emit_registration(keys, counters);
+    }
+};
+
+// Note:
+// Applies the profile written by an instrumented program (--profile-use).
+//   - Conditional branches and switches are given branch weights.
+//   - Functions which are never called are marked as cold.
+//   - Functions called frequently are marked with inline hint.  A function is regarded
+//     as frequently called when its count is at least 1/hot_entry_ratio of the maximum.
+// Counts of a function whose checksum doesn't match are ignored with a warning.
+class profile_annotator {
+    context &ctx;
+    llvm::Module &module;
+    std::unordered_map<std::string, std::uint64_t> counts;
+    std::unordered_map<std::string, std::uint64_t> checksums;
+
+    static constexpr std::uint64_t hot_entry_ratio = 10u;
+
+    void load(std::string const& file_name)
+    {
+        std::ifstream in{file_name};
+        if (!in) {
+            throw code_generation_error{"LLVM IR generator", boost::format("Failed to open the profile '%1%'") % file_name};
+        }
+
+        std::string key;
+        std::uint64_t count;
+        while (in >> key >> count) {
+            if (boost::algorithm::ends_with(key, ":checksum")) {
+                checksums[key] = count;
+            } else {
+                counts[key] += count;
+            }
+        }
+    }
+
+    // Note:
+    // A function which is not in the profile is not stale.  It is simply not annotated.
+    // Counts without a checksum come from an unknown build and are regarded as stale.
+    bool is_stale(profile_probe_points::entry const& e) const
+    {
+        auto const found = checksums.find(e.checksum_key);
+        if (found == std::end(checksums)) {
+            return counts.find(e.key) != std::end(counts);
+        }
+        return found->second != e.checksum;
+    }
+
+    boost::optional<std::uint64_t> count_of(std::string const& key) const
+    {
+        auto const found = counts.find(key);
+        if (found == std::end(counts)) {
+            return boost::none;
+        }
+        return found->second;
+    }
+
+    // Note:
+    // Branch weights are 32bit.  Counts are scaled not to overflow and 1 is added to
+    // them not to make any edge impossible.
+    static std::uint32_t to_weight(std::uint64_t const count, std::uint64_t const scale)
+    {
+        return static_cast<std::uint32_t>(count / scale + 1u);
+    }
+
+public:
+
+    profile_annotator(context &c, llvm::Module &m, std::string const& file_name)
+        : ctx(c), module(m)
+    {
+        load(file_name);
+    }
+
+    void annotate()
+    {
+        profile_probe_points const points{module};
+
+        std::unordered_set<llvm::Function const*> stale_funcs;
+        for (auto const& e : points.entries) {
+            if (is_stale(e)) {
+                output_warning(boost::format("Profile of function '%1%' is ignored because the function was modified after the profile was taken") % e.function->getName().str());
+                stale_funcs.insert(e.function);
+            }
+        }
+
+        std::uint64_t max_entry_count = 0u;
+        for (auto const& e : points.entries) {
+            if (helper::exists(stale_funcs, e.function)) {
+                continue;
+            }
+            if (auto const c = count_of(e.key)) {
+                max_entry_count = std::max(max_entry_count, *c);
+            }
+        }
+
+        for (auto const& e : points.entries) {
+            auto const c = count_of(e.key);
+            auto &f = *e.function;
+            if (!c || f.getName() == "main" || helper::exists(stale_funcs, &f)) {
+                continue;
+            }
+
+            if (*c == 0u) {
+                f.addFnAttr(llvm::Attribute::Cold);
+            } else if (*c * hot_entry_ratio >= max_entry_count && !f.hasFnAttribute(llvm::Attribute::NoInline)) {
+                f.addFnAttr(llvm::Attribute::InlineHint);
+            }
+        }
+
+        // Note:
+        // Edges of the same terminator are adjacent and ordered by the index of the successor.
+        llvm::MDBuilder md_builder{ctx.llvm_context};
+        for (auto itr = std::begin(points.edges); itr != std::end(points.edges);) {
+            auto *const terminator = itr->terminator;
+            auto const num_successors = terminator->getNumSuccessors();
+            assert(static_cast<std::size_t>(std::end(points.edges) - itr) >= num_successors);
+
+            std::vector<std::uint64_t> edge_counts;
+            for (; itr != std::end(points.edges) && itr->terminator == terminator; ++itr) {
+                if (auto const c = count_of(itr->key)) {
+                    edge_counts.push_back(*c);
+                }
+            }
+
+            if (edge_counts.size() != num_successors || helper::exists(stale_funcs, terminator->getParent()->getParent())) {
+                continue;
+            }
+
+            auto const max_count = *std::max_element(std::begin(edge_counts), std::end(edge_counts));
+            auto const scale = max_count / std::numeric_limits<std::uint32_t>::max() + 1u;
+
+            std::vector<std::uint32_t> weights;
+            weights.reserve(edge_counts.size());
+            for (auto const c : edge_counts) {
+                weights.push_back(to_weight(c, scale));
+            }
+
+            terminator->setMetadata(llvm::LLVMContext::MD_prof, md_builder.createBranchWeights(weights));
+        }
+    }
+};
+
+} // namespace detail
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_PROFILE_INSTRUMENTER_HPP_INCLUDED
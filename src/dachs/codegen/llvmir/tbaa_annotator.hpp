@@ -0,0 +1,100 @@
+#if !defined DACHS_CODEGEN_LLVMIR_TBAA_ANNOTATOR_HPP_INCLUDED
+#define      DACHS_CODEGEN_LLVMIR_TBAA_ANNOTATOR_HPP_INCLUDED
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/MDBuilder.h>
+
+#include "dachs/codegen/llvmir/context.hpp"
+
+namespace dachs {
+namespace codegen {
+namespace llvmir {
+namespace detail {
+
+// Note:
+// Attaches type-based alias analysis metadata to scalar loads and stores by their LLVM types.
+// It is not derived from Dachs types.  Dachs types lowered to the same LLVM type share a node
+// (e.g. int and uint share i64) and all pointers are in one class.  Aggregate loads and
+// stores and memory accessed by libdachs are not annotated.  They may alias everything.
+//
+//   Dachs TBAA
+//    |- i64
+//    |- double
+//    |- i8
+//    |- i1
+//    `- pointer
+class tbaa_annotator {
+    context &ctx;
+    llvm::MDNode *i64_node;
+    llvm::MDNode *double_node;
+    llvm::MDNode *i8_node;
+    llvm::MDNode *i1_node;
+    llvm::MDNode *pointer_node;
+
+    llvm::MDNode *node_for(llvm::Type *const t) const
+    {
+        if (t->isIntegerTy(64u)) {
+            return i64_node;
+        } else if (t->isDoubleTy()) {
+            return double_node;
+        } else if (t->isIntegerTy(8u)) {
+            return i8_node;
+        } else if (t->isIntegerTy(1u)) {
+            return i1_node;
+        } else if (t->isPointerTy()) {
+            return pointer_node;
+        } else {
+            return nullptr;
+        }
+    }
+
+    void annotate(llvm::Instruction &inst, llvm::Type *const accessed_type)
+    {
+        if (inst.getMetadata(llvm::LLVMContext::MD_tbaa)) {
+            return;
+        }
+
+        if (auto *const node = node_for(accessed_type)) {
+            inst.setMetadata(llvm::LLVMContext::MD_tbaa, node);
+        }
+    }
+
+public:
+
+    explicit tbaa_annotator(context &c)
+        : ctx(c)
+    {
+        llvm::MDBuilder md_builder{ctx.llvm_context};
+        auto *const root = md_builder.createTBAARoot("Dachs TBAA");
+        i64_node = md_builder.createTBAANode("i64", root);
+        double_node = md_builder.createTBAANode("double", root);
+        i8_node = md_builder.createTBAANode("i8", root);
+        i1_node = md_builder.createTBAANode("i1", root);
+        pointer_node = md_builder.createTBAANode("pointer", root);
+    }
+
+    void annotate(llvm::Module &module)
+    {
+        for (auto &f : module) {
+            for (auto &b : f) {
+                for (auto &i : b) {
+                    if (auto *const load = llvm::dyn_cast<llvm::LoadInst>(&i)) {
+                        annotate(i, load->getType());
+                    } else if (auto *const store = llvm::dyn_cast<llvm::StoreInst>(&i)) {
+                        annotate(i, store->getValueOperand()->getType());
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace detail
+} // namespace llvmir
+} // namespace codegen
+} // namespace dachs
+
+#endif    // DACHS_CODEGEN_LLVMIR_TBAA_ANNOTATOR_HPP_INCLUDED
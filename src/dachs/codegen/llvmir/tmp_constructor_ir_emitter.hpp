@@ -13,6 +13,7 @@
 #include "dachs/semantics/type.hpp"
 #include "dachs/codegen/llvmir/context.hpp"
 #include "dachs/codegen/llvmir/type_ir_emitter.hpp"
+#include "dachs/codegen/llvmir/ir_builder_helper.hpp"
 #include "dachs/helper/util.hpp"
 
 namespace dachs {
@@ -62,7 +63,7 @@ class tmp_constructor_ir_emitter {
                 return llvm::ConstantArray::get(ty, elems);
 
             } else {
-                auto *const allocated = ctx.builder.CreateAlloca(ty);
+                auto *const allocated = create_alloca_in_entry_block(ctx, ty);
 
                 if (arg_values.size() == 1) {
                     ctx.builder.CreateMemSet(
@@ -11,6 +11,7 @@
 
 #include "dachs/semantics/type.hpp"
 #include "dachs/codegen/llvmir/context.hpp"
+#include "dachs/codegen/llvmir/dynamic_array_ir_emitter.hpp"
 
 namespace dachs {
 namespace codegen {
@@ -66,11 +67,14 @@ class tmp_member_ir_emitter {
                         ty = ty->getPointerElementType();
                     }
 
-                    if (!llvm::isa<llvm::ArrayType>(ty)) {
-                        return nullptr;
+                    if (llvm::isa<llvm::ArrayType>(ty)) {
+                        return ctx.builder.getInt64(ty->getArrayNumElements());
                     }
 
-                    return ctx.builder.getInt64(ty->getArrayNumElements());
+                    // Note:
+                    // The value is a handle of dynamic array or a pointer to it
+                    auto *const handle = ty->isPointerTy() ? ctx.builder.CreateLoad(value) : value;
+                    return dynamic_array::emit_length(ctx, handle);
                 }
             }
 
@@ -22,6 +22,7 @@ namespace llvmir {
 class type_ir_emitter {
     llvm::LLVMContext &context;
     semantics::lambda_captures_type lambda_captures;
+    semantics::non_escaping_lambdas_type non_escaping_lambdas;
 
     template<class String>
     void error(String const& msg)
@@ -40,8 +41,8 @@ class type_ir_emitter {
 
 public:
 
-    type_ir_emitter(llvm::LLVMContext &c, decltype(lambda_captures) const& lc)
-        : context(c), lambda_captures(lc)
+    type_ir_emitter(llvm::LLVMContext &c, decltype(lambda_captures) const& lc, decltype(non_escaping_lambdas) const& nel)
+        : context(c), lambda_captures(lc), non_escaping_lambdas(nel)
     {}
 
     llvm::Type *emit(type::type const& any)
@@ -105,12 +106,15 @@ public:
         return llvm::ArrayType::get(emit(a->element_type), *a->size);
     }
 
+    // Note:
+    // A dynamic array is a handle to its header in heap.
+    // See dachs/codegen/llvmir/dynamic_array_ir_emitter.hpp
     llvm::Type *emit(type::array_type const& a)
     {
         if (a->size) {
             return emit_fixed_array(a);
         } else {
-            throw not_implemented_error{__FILE__, __func__, __LINE__, "variable array type LLVM IR generation"};
+            return llvm::Type::getInt8PtrTy(context);
         }
     }
 
@@ -140,7 +144,12 @@ public:
         std::vector<llvm::Type *> capture_types;
         capture_types.reserve(captures.size());
         for (auto const& capture : captures.get<semantics::tags::offset>()) {
-            capture_types.push_back(emit(capture.introduced->type));
+            auto *const capture_type = emit(capture.introduced->type);
+            capture_types.push_back(
+                    semantics::is_captured_by_reference(non_escaping_lambdas, scope, capture) ?
+                        capture_type->getPointerTo() :
+                        capture_type
+                );
         }
 
         return llvm::StructType::get(context, capture_types);
@@ -151,9 +160,15 @@ public:
         throw not_implemented_error{__FILE__, __func__, __LINE__, "dictionary type LLVM IR generation"};
     }
 
-    llvm::Type *emit(type::range_type const&)
+    // Note:
+    // A range is a pair of its begin and end.  Inclusiveness is a part of the type.
+    llvm::StructType *emit(type::range_type const& r)
     {
-        throw not_implemented_error{__FILE__, __func__, __LINE__, "range type LLVM IR generation"};
+        auto *const elem_type = emit(r->element_type);
+        return check(
+            llvm::StructType::get(context, std::vector<llvm::Type *>{elem_type, elem_type})
+            , "range type"
+        );
     }
 
     llvm::Type *emit(type::qualified_type const&)
@@ -30,7 +30,7 @@ std::string compiler::read(std::string const& file) const
 std::string compiler::compile(compiler::files_type const& files, std::vector<std::string> const& libdirs, bool const colorful, bool const debug) const
 {
     std::vector<llvm::Module *> modules;
-    codegen::llvmir::context context;
+    codegen::llvmir::context context{codegen_opts};
 
     for (auto const& f : files) {
         auto const code = read(f);
@@ -47,7 +47,8 @@ std::string compiler::compile(compiler::files_type const& files, std::vector<std
         if (debug) {
             std::cerr << "=========Scope Tree=========\n\n"
                       <<  scope::stringize_scope_tree(ctx.scopes) << "\n\n";
-
+            ctx.dump_dropped_functions();
+            std::cerr << '\n';
         }
 
         auto &module = codegen::llvmir::emit_llvm_ir(ast, ctx, context);
@@ -59,13 +60,19 @@ std::string compiler::compile(compiler::files_type const& files, std::vector<std
         modules.push_back(&module);
     }
 
+    if (debug) {
+        std::cerr << "=========Code Size=========\n\n"
+                  << "Merged functions: " << context.size_stats.merged_functions << '\n'
+                  << "Removed instructions: " << context.size_stats.removed_instructions << "\n\n";
+    }
+
     return codegen::llvmir::generate_executable(modules, libdirs, context);
 }
 
 std::vector<std::string> compiler::compile_to_objects(compiler::files_type const& files, bool const colorful, bool const debug) const
 {
     std::vector<llvm::Module *> modules;
-    codegen::llvmir::context context;
+    codegen::llvmir::context context{codegen_opts};
 
     for (auto const& f : files) {
         auto const code = read(f);
@@ -106,7 +113,7 @@ std::string compiler::report_llvm_ir(std::string const& file, std::string const&
     std::string result;
     llvm::raw_string_ostream raw_os{result};
 
-    codegen::llvmir::context context;
+    codegen::llvmir::context context{codegen_opts};
     codegen::llvmir::emit_llvm_ir(ast, ctx, context).print(raw_os, nullptr);
     return result;
 }
@@ -7,11 +7,13 @@
 #include "dachs/ast/ast_fwd.hpp"
 #include "dachs/parser/parser.hpp"
 #include "dachs/semantics/scope.hpp"
+#include "dachs/codegen/llvmir/codegen_options.hpp"
 
 namespace dachs {
 
 class compiler final {
     syntax::parser parser;
+    codegen::llvmir::codegen_options const codegen_opts;
 
     using files_type = std::vector<std::string>;
 
@@ -19,6 +21,10 @@ class compiler final {
 
 public:
 
+    explicit compiler(codegen::llvmir::codegen_options const& opts = codegen::llvmir::codegen_options{})
+        : parser(), codegen_opts(opts)
+    {}
+
     std::string compile(files_type const& files, files_type const& libdirs, bool const colorful = true, bool const debug = false) const;
     std::vector<std::string> compile_to_objects(files_type const& files, bool const colorful = true, bool const debug = false) const;
 
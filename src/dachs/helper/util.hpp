@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <initializer_list>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/optional.hpp>
 #include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm/find_if.hpp>
@@ -138,6 +139,12 @@ bool exists(std::unordered_map<Key, Value> const& m, T const& t) noexcept
     return m.find(t) != std::end(m);
 }
 
+template<class Value, class T>
+bool exists(std::unordered_set<Value> const& s, T const& t) noexcept
+{
+    return s.find(t) != std::end(s);
+}
+
 } // namespace helper
 }  // namespace dachs
 
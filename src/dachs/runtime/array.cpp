@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// Note:
+// The layout must be the same as the header of dynamic arrays in LLVM IR.
+// See dachs/codegen/llvmir/dynamic_array_ir_emitter.hpp
+struct __dachs_array_header {
+    char *data;
+    std::int64_t length;
+    std::int64_t capacity;
+};
+
+namespace {
+
+void __dachs_array_fatal(char const* const msg)
+{
+    std::fprintf(stderr, "%s\n", msg);
+    std::abort();
+}
+
+} // namespace
+
+extern "C" {
+    __dachs_array_header *__dachs_array_new__(std::int64_t const elem_size, std::int64_t const length)
+    {
+        if (length < 0) {
+            __dachs_array_fatal("Error: Negative length of array");
+        }
+
+        auto *const header = static_cast<__dachs_array_header *>(std::malloc(sizeof(__dachs_array_header)));
+        if (!header) {
+            __dachs_array_fatal("Error: Failed to allocate an array");
+        }
+
+        header->length = length;
+        header->capacity = length;
+        header->data = length == 0 ? nullptr : static_cast<char *>(std::calloc(length, elem_size));
+        if (length != 0 && !header->data) {
+            __dachs_array_fatal("Error: Failed to allocate an array");
+        }
+
+        return header;
+    }
+
+    // Note:
+    // Returns the address of the new last element.  The capacity is doubled when the array is full.
+    void *__dachs_array_push_slot__(__dachs_array_header *const header, std::int64_t const elem_size)
+    {
+        if (header->length == header->capacity) {
+            auto const new_capacity = header->capacity == 0 ? 4 : header->capacity * 2;
+            auto *const new_data = static_cast<char *>(std::realloc(header->data, new_capacity * elem_size));
+            if (!new_data) {
+                __dachs_array_fatal("Error: Failed to extend an array");
+            }
+            header->data = new_data;
+            header->capacity = new_capacity;
+        }
+
+        auto *const slot = header->data + header->length * elem_size;
+        std::memset(slot, 0, elem_size);
+        ++header->length;
+        return slot;
+    }
+
+    void __dachs_array_index_out_of_bounds__(std::int64_t const index, std::int64_t const length)
+    {
+        std::fprintf(stderr, "Error: Index out of bounds (index:%lld, length:%lld)\n", static_cast<long long>(index), static_cast<long long>(length));
+        std::abort();
+    }
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+
+// Note:
+// Counters of instrumented programs (--profile-generate).  Each module registers its
+// counters in its constructor.  They are written to the profile file at exit.
+// The file is specified by DACHS_PROFILE_FILE environment variable ('dachs.profile' by default).
+// Each line of the file is '{key} {count}'.  Checksums of functions are registered as
+// counters which are never incremented.
+// See dachs/codegen/llvmir/profile_instrumenter.hpp
+
+namespace {
+
+struct registered_counters {
+    char const* const* keys;
+    std::uint64_t const* counters;
+    std::int64_t num;
+};
+
+std::vector<registered_counters> &get_registered_counters()
+{
+    static std::vector<registered_counters> registered;
+    return registered;
+}
+
+void __dachs_profile_write()
+{
+    char const* const env_path = std::getenv("DACHS_PROFILE_FILE");
+    auto *const out = std::fopen(env_path ? env_path : "dachs.profile", "w");
+    if (!out) {
+        std::fprintf(stderr, "Warning: Failed to open the profile file\n");
+        return;
+    }
+
+    for (auto const& r : get_registered_counters()) {
+        for (std::int64_t i = 0; i < r.num; ++i) {
+            std::fprintf(out, "%s %llu\n", r.keys[i], static_cast<unsigned long long>(r.counters[i]));
+        }
+    }
+
+    std::fclose(out);
+}
+
+} // namespace
+
+extern "C" {
+    void __dachs_profile_register__(char const* const* const keys, std::uint64_t const* const counters, std::int64_t const num)
+    {
+        auto &registered = get_registered_counters();
+        if (registered.empty()) {
+            std::atexit(__dachs_profile_write);
+        }
+        registered.push_back({keys, counters, num});
+    }
+}
@@ -0,0 +1,16 @@
+#include <cstdint>
+
+extern "C" {
+    // Note:
+    // Hash of string labels of switch statements.
+    // This MUST be the same as string_hash() in dachs/codegen/llvmir/perfect_hash.hpp
+    std::uint64_t __dachs_string_hash__(char const* const s, std::uint64_t const seed)
+    {
+        std::uint64_t h = 14695981039346656037ull ^ seed;
+        for (auto p = reinterpret_cast<unsigned char const*>(s); *p != '\0'; ++p) {
+            h ^= *p;
+            h *= 1099511628211ull;
+        }
+        return h ^ (h >> 32);
+    }
+}
@@ -5,6 +5,8 @@
 #include <unordered_set>
 #include <tuple>
 #include <set>
+#include <sstream>
+#include <algorithm>
 
 #include <boost/variant/apply_visitor.hpp>
 #include <boost/variant/static_visitor.hpp>
@@ -27,6 +29,13 @@
 #include "dachs/semantics/error.hpp"
 #include "dachs/semantics/semantics_context.hpp"
 #include "dachs/semantics/lambda_capture_resolver.hpp"
+#include "dachs/semantics/call_graph.hpp"
+#include "dachs/semantics/lambda_escape_analyzer.hpp"
+#include "dachs/semantics/compile_time_evaluator.hpp"
+#include "dachs/semantics/effect_analyzer.hpp"
+#include "dachs/semantics/last_use_analyzer.hpp"
+#include "dachs/semantics/bounds_check_analyzer.hpp"
+#include "dachs/semantics/tail_recursion_analyzer.hpp"
 #include "dachs/semantics/tmp_member_checker.hpp"
 #include "dachs/semantics/tmp_constructor_checker.hpp"
 #include "dachs/fatal.hpp"
@@ -74,6 +83,9 @@ struct weak_ptr_locker : public boost::static_visitor<scope::any_scope> {
     }
 };
 
+// Note:
+// Functions are analyzed in reverse topological order of the call graph.  This resolver
+// is needed only for recursive calls among functions in the same SCC.
 // TODO:
 // If recursive call is used in 'if' expression, it fails to deduce
 // func fib(n)
@@ -159,6 +171,25 @@ class symbol_analyzer {
     std::unordered_map<type::generic_func_type, ast::node::tuple_literal> lambda_instantiation_map;
     std::unordered_set<ast::node::function_definition> already_visited_functions;
 
+    // Note:
+    // Functions are not analyzed in the order of definitions because callees are analyzed
+    // before their callers.  Diagnostics are buffered with their positions and output
+    // in the order of the source by flush_diagnostics().
+    struct diagnostic {
+        std::size_t line;
+        std::size_t col;
+        std::string message;
+    };
+    std::vector<diagnostic> diagnostics;
+
+    template<class Node>
+    void add_diagnostic(Node const& n, std::ostringstream const& output)
+    {
+        if (!output.str().empty()) {
+            diagnostics.push_back({n->line, n->col, output.str()});
+        }
+    }
+
     // Introduce a new scope and ensure to restore the old scope
     // after the visit process
     template<class Scope, class Walker>
@@ -173,7 +204,9 @@ class symbol_analyzer {
     template<class Node, class Message>
     void semantic_error(Node const& n, Message const& msg) noexcept
     {
-        output_semantic_error(n, msg);
+        std::ostringstream output;
+        output_semantic_error(n, msg, output);
+        add_diagnostic(n, output);
         failed++;
     }
 
@@ -363,6 +396,19 @@ public:
         return failed;
     }
 
+    void flush_diagnostics(std::ostream &ost = std::cerr)
+    {
+        std::stable_sort(
+                std::begin(diagnostics),
+                std::end(diagnostics),
+                [](auto const& l, auto const& r){ return std::tie(l.line, l.col) < std::tie(r.line, r.col); }
+            );
+        for (auto const& d : diagnostics) {
+            ost << d.message;
+        }
+        diagnostics.clear();
+    }
+
     auto get_lambda_captures() const noexcept
     {
         return captures;
@@ -524,7 +570,10 @@ public:
                         = calculate_from_type_nodes(*decl->maybe_type);
                 }
 
-                if (!scope->define_variable(new_var)) {
+                std::ostringstream output;
+                auto const defined = scope->define_variable(new_var, output);
+                add_diagnostic(decl, output);
+                if (!defined) {
                     failed++;
                     return false;
                 }
@@ -882,8 +931,13 @@ public:
             }
             bin_expr->type = type::get_builtin_type("bool", type::no_opt);
         } else if (bin_expr->op == ".." || bin_expr->op == "...") {
-            // TODO: Range type
-            throw not_implemented_error{bin_expr, __FILE__, __func__, __LINE__, "builtin range type"};
+            if (!lhs_type.is_builtin("int") && !lhs_type.is_builtin("uint") && !lhs_type.is_builtin("char")) {
+                semantic_error(bin_expr, boost::format("Range only supports int, uint and char\nNote: Operand type is '%1%'") % lhs_type.to_string());
+                return;
+            }
+            // Note:
+            // 'a..b' includes 'b' and 'a...b' excludes it
+            bin_expr->type = type::make<type::range_type>(lhs_type, bin_expr->op == "..");
         } else {
             bin_expr->type = lhs_type;
         }
@@ -965,6 +1019,16 @@ public:
         auto func = *maybe_func;
 
         if (func->is_builtin) {
+            if (func->name == "push") {
+                auto const array_type = type::get<type::array_type>(arg_types[0]);
+                if (!array_type || (*array_type)->size) {
+                    return (boost::format("1st argument of 'push' must be a dynamic array but '%1%'") % arg_types[0].to_string()).str();
+                }
+                if (type::type{(*array_type)->element_type} != arg_types[1]) {
+                    return (boost::format("Type of the pushed value mismatches\nNote: '%1%' is pushed to '%2%'") % arg_types[1].to_string() % arg_types[0].to_string()).str();
+                }
+            }
+
             assert(func->ret_type);
             node->type = *func->ret_type;
             node->callee_scope = func;
@@ -983,6 +1047,10 @@ public:
         }
 
         if (!func_def->ret_type) {
+            // Note:
+            // Callees are analyzed before their callers in reverse topological order of the call graph.
+            // So the return type is not determined here only when the callee is in the same SCC
+            // as the caller, which means a recursive call.
             auto saved_current_scope = current_scope;
             current_scope = global; // enclosing scope of function scope is always global scope
             ast::walk_topdown(func_def, *this);
@@ -1027,10 +1095,6 @@ public:
         return true;
     }
 
-    // TODO:
-    // If return type of function is not determined, interrupt current parsing and parse the
-    // function at first.  Add the function to the list which are already visited and check it at
-    // function_definition node
     template<class Walker>
     void visit(ast::node::func_invocation const& invocation, Walker const& recursive_walker)
     {
@@ -1624,9 +1688,28 @@ public:
     }
 
     template<class Walker>
-    void visit(ast::node::inu const& inu, Walker const& recursive_walker)
+    void visit(ast::node::inu const& inu, Walker const&)
     {
-        recursive_walker();
+        // Note:
+        // Functions are analyzed in reverse topological order of the call graph.  Return types of
+        // callees are deduced before their callers are analyzed.  Global constants are analyzed
+        // in the order of definitions.
+        call_graph graph{inu};
+        for (auto &d : inu->definitions) {
+            if (auto const maybe_func = get_as<ast::node::function_definition>(d)) {
+                graph.visit_sccs_from(
+                        *maybe_func,
+                        [this](auto const& scc)
+                        {
+                            for (auto f : scc) {
+                                ast::walk_topdown(f, *this);
+                            }
+                        }
+                    );
+            } else {
+                ast::walk_topdown(d, *this);
+            }
+        }
 
         inu->definitions.insert(
                 std::end(inu->definitions),
@@ -1646,6 +1729,71 @@ public:
     }
 };
 
+// Note:
+// Remove functions which are not reachable from entry points before analysis.  Entry points
+// are main function and functions referred by global constants.  When main function doesn't
+// exist (e.g. a library module), all functions are entry points.  Reachability is calculated
+// by names in the call graph, so it is conservative for overloaded functions.
+// Returns the removed functions.
+std::vector<ast::node::function_definition>
+eliminate_unreachable_functions(ast::node::inu const& root, scope::global_scope const& global)
+{
+    call_graph const graph{root};
+
+    std::vector<ast::node::function_definition> entry_points;
+    bool found_main = false;
+    for (auto const& d : root->definitions) {
+        if (auto const maybe_func = get_as<ast::node::function_definition>(d)) {
+            if ((*maybe_func)->name == "main") {
+                entry_points.push_back(*maybe_func);
+                found_main = true;
+            }
+        } else {
+            auto const referred = graph.functions_referred_from(d);
+            entry_points.insert(std::end(entry_points), std::begin(referred), std::end(referred));
+        }
+    }
+
+    if (!found_main) {
+        return {};
+    }
+
+    auto const reachable = graph.reachable_from(entry_points);
+    std::vector<ast::node::function_definition> dropped;
+
+    auto &defs = root->definitions;
+    defs.erase(
+        std::remove_if(
+            std::begin(defs),
+            std::end(defs),
+            [&](auto const& d)
+            {
+                auto const maybe_func = get_as<ast::node::function_definition>(d);
+                if (!maybe_func || reachable.find(*maybe_func) != std::end(reachable)) {
+                    return false;
+                }
+                dropped.push_back(*maybe_func);
+                return true;
+            }),
+        std::end(defs)
+    );
+
+    std::unordered_set<ast::node::function_definition> const dropped_set{std::begin(dropped), std::end(dropped)};
+    auto &funcs = global->functions;
+    funcs.erase(
+        std::remove_if(
+            std::begin(funcs),
+            std::end(funcs),
+            [&](auto const& f)
+            {
+                return !f->is_builtin && dropped_set.find(f->get_ast_node()) != std::end(dropped_set);
+            }),
+        std::end(funcs)
+    );
+
+    return dropped;
+}
+
 // TODO:
 // Now func main(args) is not permitted and it should be permitted.
 // If main is function template and its parameter is 1, the parameter
@@ -1698,16 +1846,48 @@ bool check_main_func(std::vector<Func> const& funcs)
 
 semantics_context check_semantics(ast::ast &a, scope::scope_tree &t)
 {
+    // Note:
+    // Functions which are never called from main function are not analyzed and not emitted.
+    auto const dropped_funcs = detail::eliminate_unreachable_functions(a.root, t.root);
+
     detail::symbol_analyzer resolver{t.root, t.root};
-    ast::walk_topdown(a.root, resolver);
+    try {
+        ast::walk_topdown(a.root, resolver);
+    } catch (...) {
+        resolver.flush_diagnostics();
+        throw;
+    }
+    resolver.flush_diagnostics();
     auto const failed = resolver.num_errors();
 
     if (failed > 0 || !detail::check_main_func(t.root->functions)) {
         throw semantic_check_error{failed, "symbol resolution"};
     }
 
+    // Note:
+    // Initializers of global constants and invocations of pure functions with literal
+    // arguments are evaluated at compile time.
+    detail::fold_compile_time_constants(a.root);
+
+    auto const captures = resolver.get_lambda_captures();
+    auto const non_escaping_lambdas = detail::analyze_lambda_escapes(a.root, captures);
+    auto const function_effects = detail::analyze_function_effects(a.root, captures, non_escaping_lambdas);
+    auto const last_uses = detail::analyze_last_uses(a.root, captures);
+    auto const in_bounds_accesses = detail::analyze_in_bounds_accesses(a.root);
+    auto const tail_recursions = detail::analyze_tail_recursions(a.root);
+
     // TODO
-    return {t, resolver.get_lambda_captures(), resolver.get_lambda_instantiation_map()};
+    return {
+        t,
+        captures,
+        resolver.get_lambda_instantiation_map(),
+        non_escaping_lambdas,
+        dropped_funcs,
+        function_effects,
+        last_uses,
+        in_bounds_accesses,
+        tail_recursions
+    };
 }
 
 } // namespace semantics
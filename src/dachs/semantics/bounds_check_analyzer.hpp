@@ -0,0 +1,260 @@
+#if !defined DACHS_SEMANTICS_BOUNDS_CHECK_ANALYZER_HPP_INCLUDED
+#define      DACHS_SEMANTICS_BOUNDS_CHECK_ANALYZER_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+#include <boost/optional.hpp>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/semantics/symbol.hpp"
+#include "dachs/semantics/type.hpp"
+#include "dachs/semantics/semantics_context.hpp"
+#include "dachs/helper/variant.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+using helper::variant::get_as;
+
+// Note:
+// Range analysis to find index accesses whose indices are provably in bounds.
+// Bounds checks of such accesses are not emitted.  An index is in bounds when
+//   - it is the iteration variable of 'for i in b...e' or 'for i in b..e', or
+//   - it is an immutable uint variable in 'if i < e' statement,
+// where 'b' is non-negative and 'e' is the size of the accessed array or a constant
+// which is not greater than it.  The size of a dynamic array is only used when the
+// variable of the array is immutable because the length of a dynamic array never shrinks.
+class bounds_check_analyzer {
+    struct index_bound {
+        symbol::var_symbol index;
+        boost::optional<std::uint64_t> size = boost::none;
+        symbol::var_symbol array = nullptr;
+    };
+
+    in_bounds_accesses_type in_bounds_accesses;
+    std::vector<index_bound> bounds;
+
+    static boost::optional<std::uint64_t> constant_of(ast::node::any_expr const& e)
+    {
+        if (auto const lit = get_as<ast::node::primary_literal>(e)) {
+            if (auto const u = get_as<unsigned int>((*lit)->value)) {
+                return std::uint64_t{*u};
+            } else if (auto const i = get_as<int>((*lit)->value)) {
+                if (*i >= 0) {
+                    return static_cast<std::uint64_t>(*i);
+                }
+            }
+        }
+        return boost::none;
+    }
+
+    static bool is_non_negative(ast::node::any_expr const& e)
+    {
+        return type::type_of(e).is_builtin("uint") || constant_of(e);
+    }
+
+    static boost::optional<symbol::var_symbol> immutable_symbol_of(ast::node::any_expr const& e)
+    {
+        auto const var = get_as<ast::node::var_ref>(e);
+        if (!var || (*var)->symbol.expired()) {
+            return boost::none;
+        }
+
+        auto const sym = (*var)->symbol.lock();
+        if (!sym->immutable) {
+            return boost::none;
+        }
+        return sym;
+    }
+
+    // Note:
+    // Returns the bound of 'e' when 'index < e' holds.  'index' must be non-negative.
+    static boost::optional<index_bound> bound_of(symbol::var_symbol const& index, ast::node::any_expr const& e)
+    {
+        if (auto const c = constant_of(e)) {
+            return index_bound{index, *c};
+        }
+
+        auto const ufcs = get_as<ast::node::ufcs_invocation>(e);
+        if (!ufcs || (*ufcs)->member_name != "size" || !(*ufcs)->callee_scope.expired()) {
+            return boost::none;
+        }
+
+        auto const array = type::get<type::array_type>(type::type_of((*ufcs)->child));
+        if (!array) {
+            return boost::none;
+        }
+
+        if ((*array)->size) {
+            return index_bound{index, std::uint64_t{*(*array)->size}};
+        }
+
+        if (auto const array_sym = immutable_symbol_of((*ufcs)->child)) {
+            return index_bound{index, boost::none, *array_sym};
+        }
+
+        return boost::none;
+    }
+
+    static boost::optional<index_bound> bound_of_range(ast::node::for_stmt const& for_)
+    {
+        if (for_->iter_vars.size() != 1u) {
+            return boost::none;
+        }
+
+        auto const& param = for_->iter_vars[0];
+        if (param->is_var || param->param_symbol.expired()) {
+            return boost::none;
+        }
+
+        auto const range = get_as<ast::node::binary_expr>(for_->range_expr);
+        if (!range || !is_non_negative((*range)->lhs)) {
+            return boost::none;
+        }
+
+        auto const index = param->param_symbol.lock();
+        if ((*range)->op == "...") {
+            return bound_of(index, (*range)->rhs);
+        } else if ((*range)->op == "..") {
+            if (auto const c = constant_of((*range)->rhs)) {
+                return index_bound{index, *c + 1u};
+            }
+        }
+
+        return boost::none;
+    }
+
+    static void collect_bounds_of_condition(ast::node::any_expr const& cond, std::vector<index_bound> &collected)
+    {
+        auto const bin_expr = get_as<ast::node::binary_expr>(cond);
+        if (!bin_expr) {
+            return;
+        }
+
+        if ((*bin_expr)->op == "&&") {
+            collect_bounds_of_condition((*bin_expr)->lhs, collected);
+            collect_bounds_of_condition((*bin_expr)->rhs, collected);
+            return;
+        }
+
+        if ((*bin_expr)->op != "<" || !type::type_of((*bin_expr)->lhs).is_builtin("uint")) {
+            return;
+        }
+
+        if (auto const index = immutable_symbol_of((*bin_expr)->lhs)) {
+            if (auto const bound = bound_of(*index, (*bin_expr)->rhs)) {
+                collected.push_back(*bound);
+            }
+        }
+    }
+
+    bool is_in_bounds(ast::node::index_access const& access) const
+    {
+        auto const array = type::get<type::array_type>(type::type_of(access->child));
+        auto const index = immutable_symbol_of(access->index_expr);
+        if (!array || !index) {
+            return false;
+        }
+
+        auto const array_sym = immutable_symbol_of(access->child);
+
+        for (auto const& b : bounds) {
+            if (b.index != *index) {
+                continue;
+            }
+
+            if (b.size && (*array)->size && *b.size <= *(*array)->size) {
+                return true;
+            }
+
+            if (b.array && array_sym && b.array == *array_sym) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    template<class Walker>
+    void walk_with_bounds(std::vector<index_bound> const& added, Walker const& walk)
+    {
+        bounds.insert(std::end(bounds), std::begin(added), std::end(added));
+        walk();
+        bounds.erase(std::end(bounds) - added.size(), std::end(bounds));
+    }
+
+public:
+
+    in_bounds_accesses_type const& get_in_bounds_accesses() const noexcept
+    {
+        return in_bounds_accesses;
+    }
+
+    template<class Walker>
+    void visit(ast::node::function_definition const& func, Walker const& w)
+    {
+        if (func->is_template()) {
+            for (auto i : func->instantiated) {
+                ast::walk_topdown(i, *this);
+            }
+            return;
+        }
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::for_stmt const& for_, Walker const& w)
+    {
+        std::vector<index_bound> added;
+        if (auto const bound = bound_of_range(for_)) {
+            added.push_back(*bound);
+        }
+        walk_with_bounds(added, [&]{ w(); });
+    }
+
+    template<class Walker>
+    void visit(ast::node::if_stmt const& if_, Walker const& w)
+    {
+        w(if_->condition);
+
+        std::vector<index_bound> added;
+        if (if_->kind == ast::symbol::if_kind::if_) {
+            collect_bounds_of_condition(if_->condition, added);
+        }
+        walk_with_bounds(added, [&]{ w(if_->then_stmts); });
+
+        w(if_->elseif_stmts_list, if_->maybe_else_stmts);
+    }
+
+    template<class Walker>
+    void visit(ast::node::index_access const& access, Walker const& w)
+    {
+        w();
+        if (is_in_bounds(access)) {
+            in_bounds_accesses.insert(access);
+        }
+    }
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+template<class Node>
+in_bounds_accesses_type analyze_in_bounds_accesses(Node &root)
+{
+    bounds_check_analyzer analyzer;
+    ast::walk_topdown(root, analyzer);
+    return analyzer.get_in_bounds_accesses();
+}
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_BOUNDS_CHECK_ANALYZER_HPP_INCLUDED
@@ -0,0 +1,191 @@
+#if !defined DACHS_SEMANTICS_CALL_GRAPH_HPP_INCLUDED
+#define      DACHS_SEMANTICS_CALL_GRAPH_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/helper/variant.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+using std::size_t;
+
+// Note:
+// Collect names which may refer functions in the function body.
+// Callees are not resolved yet at this point.  So all names of variable references and
+// UFCS members are gathered.  Bodies of lambdas and do-end blocks are also gathered
+// because they are analyzed while analyzing the enclosing function.
+struct callee_name_collector {
+    std::unordered_set<std::string> names;
+
+    template<class Walker>
+    void visit(ast::node::var_ref const& var, Walker const& w)
+    {
+        names.insert(var->name);
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::ufcs_invocation const& ufcs, Walker const& w)
+    {
+        names.insert(ufcs->member_name);
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::lambda_expr const& lambda, Walker const&)
+    {
+        auto def = lambda->def;
+        ast::walk_topdown(def, *this);
+    }
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+// Note:
+// Call graph among functions defined in a program.
+// Strongly connected components (SCCs) are calculated by Tarjan's algorithm.  It emits SCCs
+// in reverse topological order of the graph, so callees are always emitted before their callers.
+// Functions in the same SCC call each other recursively.
+class call_graph {
+    using func_def = ast::node::function_definition;
+
+    struct vertex_state {
+        size_t index;
+        size_t lowlink;
+        bool on_stack;
+    };
+
+    std::unordered_map<std::string, std::vector<func_def>> funcs_by_name;
+    std::unordered_map<func_def, std::vector<func_def>> callees;
+    std::unordered_map<func_def, vertex_state> states;
+    std::vector<func_def> stack;
+    size_t next_index = 0u;
+
+    template<class Emitter>
+    void strong_connect(func_def const& f, Emitter const& emit)
+    {
+        states[f] = vertex_state{next_index, next_index, true};
+        ++next_index;
+        stack.push_back(f);
+
+        for (auto const& callee : callees[f]) {
+            auto const s = states.find(callee);
+            if (s == std::end(states)) {
+                strong_connect(callee, emit);
+                states[f].lowlink = std::min(states[f].lowlink, states[callee].lowlink);
+            } else if (s->second.on_stack) {
+                states[f].lowlink = std::min(states[f].lowlink, s->second.index);
+            }
+        }
+
+        if (states[f].lowlink != states[f].index) {
+            return;
+        }
+
+        std::vector<func_def> scc;
+        func_def member;
+        do {
+            member = stack.back();
+            stack.pop_back();
+            states[member].on_stack = false;
+            scc.push_back(member);
+        } while (member != f);
+
+        // Note:
+        // Keep the order of definitions in the SCC
+        std::reverse(std::begin(scc), std::end(scc));
+        emit(scc);
+    }
+
+public:
+
+    explicit call_graph(ast::node::inu const& root)
+    {
+        for (auto const& d : root->definitions) {
+            if (auto const maybe_func = helper::variant::get_as<func_def>(d)) {
+                funcs_by_name[(*maybe_func)->name].push_back(*maybe_func);
+            }
+        }
+
+        for (auto const& d : root->definitions) {
+            if (auto const maybe_func = helper::variant::get_as<func_def>(d)) {
+                callees[*maybe_func] = functions_referred_from(*maybe_func);
+            }
+        }
+    }
+
+    template<class Node>
+    std::vector<func_def> functions_referred_from(Node const& node) const
+    {
+        auto n = node;
+        callee_name_collector collector;
+        ast::walk_topdown(n, collector);
+
+        std::vector<func_def> referred;
+        for (auto const& name : collector.names) {
+            auto const found = funcs_by_name.find(name);
+            if (found != std::end(funcs_by_name)) {
+                // Note:
+                // Overloaded functions can't be distinguished before overload resolution.
+                // All of them are considered as callees.
+                referred.insert(std::end(referred), std::begin(found->second), std::end(found->second));
+            }
+        }
+
+        return referred;
+    }
+
+    std::vector<func_def> const& callees_of(func_def const& f) const
+    {
+        return callees.at(f);
+    }
+
+    std::unordered_set<func_def> reachable_from(std::vector<func_def> const& roots) const
+    {
+        std::unordered_set<func_def> reached{std::begin(roots), std::end(roots)};
+        std::vector<func_def> worklist = roots;
+
+        while (!worklist.empty()) {
+            auto const f = worklist.back();
+            worklist.pop_back();
+            for (auto const& callee : callees_of(f)) {
+                if (reached.insert(callee).second) {
+                    worklist.push_back(callee);
+                }
+            }
+        }
+
+        return reached;
+    }
+
+    // Note:
+    // Call 'emit' with each SCC reachable from 'f' which is not emitted yet.
+    // The SCCs are passed in reverse topological order.
+    template<class Emitter>
+    void visit_sccs_from(func_def const& f, Emitter const& emit)
+    {
+        if (states.find(f) != std::end(states)) {
+            return;
+        }
+        strong_connect(f, emit);
+    }
+};
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_CALL_GRAPH_HPP_INCLUDED
@@ -0,0 +1,1294 @@
+#if !defined DACHS_SEMANTICS_COMPILE_TIME_EVALUATOR_HPP_INCLUDED
+#define      DACHS_SEMANTICS_COMPILE_TIME_EVALUATOR_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/variant/variant.hpp>
+#include <boost/variant/recursive_wrapper.hpp>
+#include <boost/variant/get.hpp>
+#include <boost/optional.hpp>
+#include <boost/algorithm/cxx11/all_of.hpp>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/semantics/symbol.hpp"
+#include "dachs/semantics/scope.hpp"
+#include "dachs/semantics/type.hpp"
+#include "dachs/helper/variant.hpp"
+#include "dachs/helper/make.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+namespace ctfe {
+
+struct aggregate;
+
+// Note:
+// Values of compile-time function evaluation (CTFE).
+// int and uint are 64bit as LLVM IR.  Tuples and arrays are represented as aggregate.
+using value
+    = boost::variant<
+        bool,
+        char,
+        std::int64_t,
+        std::uint64_t,
+        double,
+        std::string,
+        boost::recursive_wrapper<aggregate>
+    >;
+
+struct aggregate {
+    std::vector<value> elements;
+};
+
+// Note:
+// Thrown when the evaluation can't be continued at compile time.  For example,
+// impure function (e.g. println) is called, unsupported expression appears or
+// the limits of evaluation are exceeded.
+struct not_evaluable {};
+
+} // namespace ctfe
+
+// Note:
+// AST interpreter which evaluates expressions over analyzed AST at compile time.
+// Only pure computation is evaluable.  Built-in functions, lambdas and do-end blocks
+// are not evaluated because they may have side effects or captures.
+class compile_time_evaluator {
+    using value = ctfe::value;
+    using frame_type = std::unordered_map<symbol::var_symbol, value>;
+
+    static constexpr std::size_t max_steps = 1000000u;
+    static constexpr std::size_t max_call_depth = 256u;
+    static constexpr std::size_t max_allocated_elements = 1u << 20;
+
+    std::unordered_map<symbol::var_symbol, value> global_constants;
+    std::vector<frame_type> frames;
+    std::unordered_set<symbol::var_symbol> aliased_vars;
+    std::size_t steps = 0u;
+    std::size_t allocated_elements = 0u;
+
+    [[noreturn]] void fail() const
+    {
+        throw ctfe::not_evaluable{};
+    }
+
+    void step()
+    {
+        if (++steps > max_steps) {
+            fail();
+        }
+    }
+
+    void allocate(std::size_t const num_elements)
+    {
+        allocated_elements += num_elements;
+        if (allocated_elements > max_allocated_elements) {
+            fail();
+        }
+    }
+
+    template<class T>
+    T const& get(value const& v) const
+    {
+        auto const ptr = boost::get<T>(&v);
+        if (!ptr) {
+            fail();
+        }
+        return *ptr;
+    }
+
+    static std::string builtin_name_of(type::type const& t)
+    {
+        if (auto const builtin = type::get<type::builtin_type>(t)) {
+            return (*builtin)->name;
+        }
+        return "";
+    }
+
+    static std::int64_t wrap(std::uint64_t const u) noexcept
+    {
+        return static_cast<std::int64_t>(u);
+    }
+
+    static char truncate_to_char(std::int64_t const i) noexcept
+    {
+        return static_cast<char>(static_cast<std::uint8_t>(i));
+    }
+
+    // Note:
+    // Signed integer operations.  'int', 'char' and 'bool' are signed in LLVM IR emitter.
+    boost::optional<value> apply_signed(std::string const& op, std::int64_t const l, std::int64_t const r) const
+    {
+        auto const ul = static_cast<std::uint64_t>(l), ur = static_cast<std::uint64_t>(r);
+        if (op == "+") {
+            return value{wrap(ul + ur)};
+        } else if (op == "-") {
+            return value{wrap(ul - ur)};
+        } else if (op == "*") {
+            return value{wrap(ul * ur)};
+        } else if (op == "/" || op == "%") {
+            if (r == 0 || (l == std::numeric_limits<std::int64_t>::min() && r == -1)) {
+                fail();
+            }
+            return value{op == "/" ? l / r : l % r};
+        } else if (op == "<<" || op == ">>") {
+            if (r < 0 || r >= 64) {
+                fail();
+            }
+            return value{op == "<<" ? wrap(ul << r) : l >> r};
+        } else if (op == "&" || op == "&&") {
+            return value{l & r};
+        } else if (op == "|" || op == "||") {
+            return value{l | r};
+        } else if (op == "^") {
+            return value{l ^ r};
+        } else if (op == "<") {
+            return value{l < r};
+        } else if (op == ">") {
+            return value{l > r};
+        } else if (op == "<=") {
+            return value{l <= r};
+        } else if (op == ">=") {
+            return value{l >= r};
+        } else if (op == "==") {
+            return value{l == r};
+        } else if (op == "!=") {
+            return value{l != r};
+        }
+        return boost::none;
+    }
+
+    value apply_unsigned(std::string const& op, std::uint64_t const l, std::uint64_t const r) const
+    {
+        if (op == "+") {
+            return l + r;
+        } else if (op == "-") {
+            return l - r;
+        } else if (op == "*") {
+            return l * r;
+        } else if (op == "/" || op == "%") {
+            if (r == 0u) {
+                fail();
+            }
+            return op == "/" ? l / r : l % r;
+        } else if (op == "<<") {
+            if (r >= 64u) {
+                fail();
+            }
+            return l << r;
+        } else if (op == ">>") {
+            // Note:
+            // The LLVM IR emitter emits arithmetic shift even if the operand is unsigned
+            if (r >= 64u) {
+                fail();
+            }
+            return static_cast<std::uint64_t>(wrap(l) >> r);
+        } else if (op == "&" || op == "&&") {
+            return l & r;
+        } else if (op == "|" || op == "||") {
+            return l | r;
+        } else if (op == "^") {
+            return l ^ r;
+        } else if (op == "<") {
+            return l < r;
+        } else if (op == ">") {
+            return l > r;
+        } else if (op == "<=") {
+            return l <= r;
+        } else if (op == ">=") {
+            return l >= r;
+        } else if (op == "==") {
+            return l == r;
+        } else if (op == "!=") {
+            return l != r;
+        }
+        fail();
+    }
+
+    value apply_float(std::string const& op, double const l, double const r) const
+    {
+        // Note:
+        // Comparisons are unordered as LLVM IR emitter.  They are true when either operand is NaN.
+        bool const unordered = std::isnan(l) || std::isnan(r);
+        if (op == "+") {
+            return l + r;
+        } else if (op == "-") {
+            return l - r;
+        } else if (op == "*") {
+            return l * r;
+        } else if (op == "/") {
+            return l / r;
+        } else if (op == "%") {
+            return std::fmod(l, r);
+        } else if (op == "<") {
+            return unordered || l < r;
+        } else if (op == ">") {
+            return unordered || l > r;
+        } else if (op == "<=") {
+            return unordered || l <= r;
+        } else if (op == ">=") {
+            return unordered || l >= r;
+        } else if (op == "==") {
+            return unordered || l == r;
+        } else if (op == "!=") {
+            return unordered || l != r;
+        }
+        fail();
+    }
+
+    value apply_binary(std::string const& op, type::type const& t, value const& lhs, value const& rhs) const
+    {
+        if (auto const tuple = type::get<type::tuple_type>(t)) {
+            if (op != "==" && op != "!=") {
+                fail();
+            }
+
+            auto const& ls = get<ctfe::aggregate>(lhs).elements;
+            auto const& rs = get<ctfe::aggregate>(rhs).elements;
+            auto const& elem_types = (*tuple)->element_types;
+            if (ls.size() != elem_types.size() || rs.size() != elem_types.size()) {
+                fail();
+            }
+
+            bool result = op == "==";
+            for (std::size_t i = 0u; i < elem_types.size(); ++i) {
+                auto const elem_result = get<bool>(apply_binary(op, elem_types[i], ls[i], rs[i]));
+                result = op == "==" ? result && elem_result : result || elem_result;
+            }
+            return result;
+        }
+
+        auto const name = builtin_name_of(t);
+        if (name == "int") {
+            if (auto const result = apply_signed(op, get<std::int64_t>(lhs), get<std::int64_t>(rhs))) {
+                return *result;
+            }
+        } else if (name == "uint") {
+            return apply_unsigned(op, get<std::uint64_t>(lhs), get<std::uint64_t>(rhs));
+        } else if (name == "float") {
+            return apply_float(op, get<double>(lhs), get<double>(rhs));
+        } else if (name == "char") {
+            auto const l = static_cast<signed char>(get<char>(lhs));
+            auto const r = static_cast<signed char>(get<char>(rhs));
+            if ((op == "/" || op == "%") && l == -128 && r == -1) {
+                fail();
+            }
+            if (auto const result = apply_signed(op, l, r)) {
+                if (auto const i = boost::get<std::int64_t>(&*result)) {
+                    return truncate_to_char(*i);
+                }
+                return *result;
+            }
+        } else if (name == "bool") {
+            auto const l = get<bool>(lhs), r = get<bool>(rhs);
+            if (op == "&" || op == "&&") {
+                return l && r;
+            } else if (op == "|" || op == "||") {
+                return l || r;
+            } else if (op == "^" || op == "!=") {
+                return l != r;
+            } else if (op == "==") {
+                return l == r;
+            }
+        }
+
+        fail();
+    }
+
+    value apply_unary(std::string const& op, type::type const& t, value const& operand) const
+    {
+        auto const name = builtin_name_of(t);
+        if (op == "+" && (name == "int" || name == "uint" || name == "float" || name == "bool")) {
+            return operand;
+        }
+
+        if (name == "int") {
+            auto const i = get<std::int64_t>(operand);
+            if (op == "-") {
+                return wrap(0u - static_cast<std::uint64_t>(i));
+            } else if (op == "~" || op == "!") {
+                return ~i;
+            }
+        } else if (name == "uint") {
+            auto const u = get<std::uint64_t>(operand);
+            if (op == "-") {
+                return 0u - u;
+            } else if (op == "~" || op == "!") {
+                return ~u;
+            }
+        } else if (name == "float") {
+            if (op == "-") {
+                return -get<double>(operand);
+            }
+        } else if (name == "bool") {
+            if (op == "!" || op == "~") {
+                return !get<bool>(operand);
+            }
+        }
+
+        fail();
+    }
+
+    template<class Float, class Int>
+    static bool is_representable(Float const f) noexcept
+    {
+        return !std::isnan(f)
+            && f >= static_cast<Float>(std::numeric_limits<Int>::min())
+            && f < static_cast<Float>(std::numeric_limits<Int>::max());
+    }
+
+    // Note:
+    // Casts follow llvm_ir_emitter::emit(ast::node::cast_expr).
+    value apply_cast(type::type const& from_type, type::type const& to_type, value const& v) const
+    {
+        if (from_type == to_type) {
+            return v;
+        }
+
+        auto const from = builtin_name_of(from_type);
+        auto const to = builtin_name_of(to_type);
+
+        if (from == "int") {
+            auto const i = get<std::int64_t>(v);
+            if (to == "uint") {
+                return static_cast<std::uint64_t>(i);
+            } else if (to == "float") {
+                return static_cast<double>(i);
+            } else if (to == "char") {
+                return truncate_to_char(i);
+            }
+        } else if (from == "uint") {
+            auto const u = get<std::uint64_t>(v);
+            if (to == "int") {
+                return wrap(u);
+            } else if (to == "float") {
+                return static_cast<double>(u);
+            } else if (to == "char") {
+                return truncate_to_char(wrap(u));
+            }
+        } else if (from == "float") {
+            auto const d = get<double>(v);
+            if (to == "int" && is_representable<double, std::int64_t>(d)) {
+                return static_cast<std::int64_t>(d);
+            } else if (to == "char" && is_representable<double, signed char>(d)) {
+                return static_cast<char>(static_cast<signed char>(d));
+            } else if (to == "uint" && !std::isnan(d) && d > -1.0 && d < static_cast<double>(std::numeric_limits<std::uint64_t>::max())) {
+                return static_cast<std::uint64_t>(d);
+            }
+        } else if (from == "char") {
+            auto const c = static_cast<signed char>(get<char>(v));
+            if (to == "int") {
+                return static_cast<std::int64_t>(c);
+            } else if (to == "uint") {
+                return static_cast<std::uint64_t>(static_cast<std::int64_t>(c));
+            } else if (to == "float") {
+                return static_cast<double>(c);
+            }
+        }
+
+        fail();
+    }
+
+    value make_aggregate(std::vector<value> && elems)
+    {
+        allocate(elems.size());
+        return ctfe::aggregate{std::move(elems)};
+    }
+
+    value *lookup_local(symbol::weak_var_symbol const& weak)
+    {
+        if (frames.empty() || weak.expired()) {
+            return nullptr;
+        }
+        auto &frame = frames.back();
+        auto const found = frame.find(weak.lock());
+        return found == std::end(frame) ? nullptr : &found->second;
+    }
+
+    bool eval_condition(ast::symbol::if_kind const kind, ast::node::any_expr const& cond)
+    {
+        auto const b = get<bool>(eval(cond));
+        return kind == ast::symbol::if_kind::unless ? !b : b;
+    }
+
+    // Evaluate expressions {{{
+    value eval(ast::node::any_expr const& e)
+    {
+        step();
+        return helper::variant::apply_lambda([this](auto const& n) -> value { return eval(n); }, e);
+    }
+
+    static value literal_value(int const i)
+    {
+        return static_cast<std::int64_t>(i);
+    }
+
+    static value literal_value(unsigned int const u)
+    {
+        return static_cast<std::uint64_t>(u);
+    }
+
+    template<class T>
+    static value literal_value(T const& v)
+    {
+        return v;
+    }
+
+    value eval(ast::node::primary_literal const& lit)
+    {
+        if (auto const s = boost::get<std::string>(&lit->value)) {
+            allocate(s->size());
+        }
+        return helper::variant::apply_lambda([](auto const& v) -> value { return literal_value(v); }, lit->value);
+    }
+
+    template<class Literal>
+    value eval_elements(Literal const& lit)
+    {
+        std::vector<value> elems;
+        elems.reserve(lit->element_exprs.size());
+        for (auto const& e : lit->element_exprs) {
+            elems.push_back(eval(e));
+        }
+        return make_aggregate(std::move(elems));
+    }
+
+    value eval(ast::node::tuple_literal const& tuple)
+    {
+        return eval_elements(tuple);
+    }
+
+    value eval(ast::node::array_literal const& array)
+    {
+        return eval_elements(array);
+    }
+
+    value eval(ast::node::var_ref const& var)
+    {
+        if (auto const local = lookup_local(var->symbol)) {
+            return *local;
+        }
+
+        if (!var->symbol.expired()) {
+            auto const found = global_constants.find(var->symbol.lock());
+            if (found != std::end(global_constants)) {
+                return found->second;
+            }
+        }
+
+        fail();
+    }
+
+    value eval(ast::node::typed_expr const& typed)
+    {
+        return eval(typed->child_expr);
+    }
+
+    value eval(ast::node::binary_expr const& bin_expr)
+    {
+        auto const lhs = eval(bin_expr->lhs);
+
+        // Note:
+        // '&&' and '||' are short-circuit as well as the generated code.  The right operand
+        // may fail to be evaluated (e.g. out of bounds index) when the left one determines the result.
+        if (auto const l = boost::get<bool>(&lhs)) {
+            if ((bin_expr->op == "&&" && !*l) || (bin_expr->op == "||" && *l)) {
+                return *l;
+            }
+        }
+
+        auto const rhs = eval(bin_expr->rhs);
+        return apply_binary(bin_expr->op, type::type_of(bin_expr->lhs), lhs, rhs);
+    }
+
+    value eval(ast::node::unary_expr const& unary)
+    {
+        return apply_unary(unary->op, type::type_of(unary->expr), eval(unary->expr));
+    }
+
+    value eval(ast::node::cast_expr const& cast)
+    {
+        return apply_cast(type::type_of(cast->child), cast->type, eval(cast->child));
+    }
+
+    value eval(ast::node::if_expr const& if_)
+    {
+        return eval_condition(if_->kind, if_->condition_expr) ? eval(if_->then_expr) : eval(if_->else_expr);
+    }
+
+    value eval(ast::node::index_access const& access)
+    {
+        auto const child = eval(access->child);
+        auto const& elems = get<ctfe::aggregate>(child).elements;
+        auto const index = eval(access->index_expr);
+
+        std::uint64_t idx = 0u;
+        if (auto const i = boost::get<std::int64_t>(&index)) {
+            if (*i < 0) {
+                fail();
+            }
+            idx = static_cast<std::uint64_t>(*i);
+        } else {
+            idx = get<std::uint64_t>(index);
+        }
+
+        if (idx >= elems.size()) {
+            fail();
+        }
+        return elems[idx];
+    }
+
+    value eval(ast::node::func_invocation const& invocation)
+    {
+        if (invocation->do_block || invocation->callee_scope.expired()) {
+            fail();
+        }
+
+        std::vector<value> args;
+        args.reserve(invocation->args.size());
+        for (auto const& a : invocation->args) {
+            args.push_back(eval(a));
+        }
+
+        return invoke(invocation->callee_scope.lock(), std::move(args));
+    }
+
+    value eval(ast::node::ufcs_invocation const& ufcs)
+    {
+        if (ufcs->do_block) {
+            fail();
+        }
+
+        auto child = eval(ufcs->child);
+
+        if (ufcs->callee_scope.expired()) {
+            // Note:
+            // Built-in data members
+            auto const& elems = get<ctfe::aggregate>(child).elements;
+            if (ufcs->member_name == "size") {
+                return static_cast<std::uint64_t>(elems.size());
+            } else if (ufcs->member_name == "first" && !elems.empty()) {
+                return elems[0];
+            } else if (ufcs->member_name == "second" && elems.size() > 1u) {
+                return elems[1];
+            }
+            fail();
+        }
+
+        std::vector<value> args;
+        args.push_back(std::move(child));
+        return invoke(ufcs->callee_scope.lock(), std::move(args));
+    }
+
+    template<class T>
+    value eval(T const&)
+    {
+        fail();
+    }
+    // }}}
+
+    value invoke(scope::func_scope const& callee, std::vector<value> && args)
+    {
+        if (callee->is_builtin
+                || callee->is_anonymous()
+                || callee->is_template()
+                || frames.size() >= max_call_depth) {
+            fail();
+        }
+
+        auto const def = callee->get_ast_node();
+        if (!def || def->params.size() != args.size()) {
+            fail();
+        }
+
+        frame_type frame;
+        for (std::size_t i = 0u; i < args.size(); ++i) {
+            auto const& sym = def->params[i]->param_symbol;
+            if (sym.expired()) {
+                fail();
+            }
+            frame[sym.lock()] = std::move(args[i]);
+        }
+
+        frames.push_back(std::move(frame));
+        auto result = exec(def->body);
+        frames.pop_back();
+
+        if (!result) {
+            // Note:
+            // Unit
+            return ctfe::aggregate{};
+        }
+
+        return *result;
+    }
+
+    // Execute statements {{{
+    // Note:
+    // Return the value when 'ret' is executed.
+    using exec_result = boost::optional<value>;
+
+    exec_result exec(ast::node::compound_stmt const& s)
+    {
+        step();
+        return helper::variant::apply_lambda([this](auto const& n) -> exec_result { return exec(n); }, s);
+    }
+
+    exec_result exec(ast::node::statement_block const& block)
+    {
+        for (auto const& s : block->value) {
+            if (auto result = exec(s)) {
+                return result;
+            }
+        }
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::any_expr const& e)
+    {
+        eval(e);
+        return boost::none;
+    }
+
+    // Note:
+    // An immutable variable and an immutable iteration variable of for statement refer the
+    // memory of the rhs instead of copying it at run time.  But values are copied in evaluation.
+    // So the evaluation fails when a variable referred by them is modified later.
+    boost::optional<symbol::var_symbol> local_root_of(ast::node::any_expr const& e)
+    {
+        if (auto const var = helper::variant::get_as<ast::node::var_ref>(e)) {
+            if (lookup_local((*var)->symbol)) {
+                return (*var)->symbol.lock();
+            }
+        } else if (auto const access = helper::variant::get_as<ast::node::index_access>(e)) {
+            return local_root_of((*access)->child);
+        }
+        return boost::none;
+    }
+
+    void mark_aliased(ast::node::any_expr const& e)
+    {
+        if (auto const root = local_root_of(e)) {
+            aliased_vars.insert(*root);
+        }
+    }
+
+    void bind(ast::node::variable_decl const& decl, value const& v)
+    {
+        if (decl->name == "_" && decl->symbol.expired()) {
+            return;
+        }
+        if (decl->symbol.expired() || frames.empty()) {
+            fail();
+        }
+        frames.back()[decl->symbol.lock()] = v;
+    }
+
+    template<class Exprs>
+    std::vector<value> eval_and_split(Exprs const& exprs, std::size_t const num_lhs)
+    {
+        std::vector<value> values;
+        for (auto const& e : exprs) {
+            values.push_back(eval(e));
+        }
+
+        if (values.size() == num_lhs) {
+            return values;
+        }
+
+        if (values.size() == 1u) {
+            auto const elems = get<ctfe::aggregate>(values[0]).elements;
+            if (elems.size() == num_lhs) {
+                return elems;
+            }
+        }
+
+        fail();
+    }
+
+    exec_result exec(ast::node::initialize_stmt const& init)
+    {
+        if (!init->maybe_rhs_exprs) {
+            fail();
+        }
+
+        auto const& rhs_exprs = *init->maybe_rhs_exprs;
+        auto const values = eval_and_split(rhs_exprs, init->var_decls.size());
+        for (std::size_t i = 0u; i < values.size(); ++i) {
+            if (rhs_exprs.size() == values.size() && !init->var_decls[i]->is_var) {
+                mark_aliased(rhs_exprs[i]);
+            }
+            bind(init->var_decls[i], values[i]);
+        }
+        return boost::none;
+    }
+
+    value &lvalue_of(ast::node::any_expr const& e)
+    {
+        if (auto const var = helper::variant::get_as<ast::node::var_ref>(e)) {
+            if (auto const local = lookup_local((*var)->symbol)) {
+                return *local;
+            }
+        } else if (auto const access = helper::variant::get_as<ast::node::index_access>(e)) {
+            auto &child = lvalue_of((*access)->child);
+            auto const index = eval((*access)->index_expr);
+            auto const agg = boost::get<ctfe::aggregate>(&child);
+            if (!agg) {
+                fail();
+            }
+
+            std::uint64_t idx = 0u;
+            if (auto const i = boost::get<std::int64_t>(&index)) {
+                if (*i < 0) {
+                    fail();
+                }
+                idx = static_cast<std::uint64_t>(*i);
+            } else {
+                idx = get<std::uint64_t>(index);
+            }
+
+            if (idx >= agg->elements.size()) {
+                fail();
+            }
+            return agg->elements[idx];
+        }
+
+        fail();
+    }
+
+    exec_result exec(ast::node::assignment_stmt const& assign)
+    {
+        auto const values = eval_and_split(assign->rhs_exprs, assign->assignees.size());
+        for (std::size_t i = 0u; i < values.size(); ++i) {
+            auto const& lhs = assign->assignees[i];
+            auto const root = local_root_of(lhs);
+            if (root && aliased_vars.find(*root) != std::end(aliased_vars)) {
+                fail();
+            }
+
+            if (assign->op == "=") {
+                lvalue_of(lhs) = values[i];
+            } else {
+                // Note:
+                // Compound assignment like '+='
+                auto const bin_op = assign->op.substr(0, assign->op.size() - 1);
+                auto const result = apply_binary(bin_op, type::type_of(lhs), eval(lhs), values[i]);
+                lvalue_of(lhs) = result;
+            }
+        }
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::if_stmt const& if_)
+    {
+        if (eval_condition(if_->kind, if_->condition)) {
+            return exec(if_->then_stmts);
+        }
+
+        for (auto const& elseif : if_->elseif_stmts_list) {
+            if (get<bool>(eval(elseif.first))) {
+                return exec(elseif.second);
+            }
+        }
+
+        if (if_->maybe_else_stmts) {
+            return exec(*if_->maybe_else_stmts);
+        }
+
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::case_stmt const& case_)
+    {
+        for (auto const& when : case_->when_stmts_list) {
+            if (get<bool>(eval(when.first))) {
+                return exec(when.second);
+            }
+        }
+
+        if (case_->maybe_else_stmts) {
+            return exec(*case_->maybe_else_stmts);
+        }
+
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::switch_stmt const& switch_)
+    {
+        auto const target_type = type::type_of(switch_->target_expr);
+        auto const target = eval(switch_->target_expr);
+
+        for (auto const& when : switch_->when_stmts_list) {
+            for (auto const& cond : when.first) {
+                if (get<bool>(apply_binary("==", target_type, target, eval(cond)))) {
+                    return exec(when.second);
+                }
+            }
+        }
+
+        if (switch_->maybe_else_stmts) {
+            return exec(*switch_->maybe_else_stmts);
+        }
+
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::while_stmt const& while_)
+    {
+        while (get<bool>(eval(while_->condition))) {
+            step();
+            if (auto result = exec(while_->body_stmts)) {
+                return result;
+            }
+        }
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::for_stmt const& for_)
+    {
+        if (for_->iter_vars.size() != 1u || for_->iter_vars[0]->param_symbol.expired() || frames.empty()) {
+            fail();
+        }
+
+        auto const range = eval(for_->range_expr);
+        auto const sym = for_->iter_vars[0]->param_symbol.lock();
+        if (!for_->iter_vars[0]->is_var) {
+            mark_aliased(for_->range_expr);
+        }
+
+        for (auto const& elem : get<ctfe::aggregate>(range).elements) {
+            step();
+            frames.back()[sym] = elem;
+            if (auto result = exec(for_->body_stmts)) {
+                return result;
+            }
+        }
+        return boost::none;
+    }
+
+    exec_result exec(ast::node::return_stmt const& ret)
+    {
+        if (ret->ret_exprs.size() == 1u) {
+            return eval(ret->ret_exprs[0]);
+        }
+
+        std::vector<value> values;
+        for (auto const& e : ret->ret_exprs) {
+            values.push_back(eval(e));
+        }
+        return make_aggregate(std::move(values));
+    }
+
+    exec_result exec(ast::node::postfix_if_stmt const& postfix_if)
+    {
+        if (!eval_condition(postfix_if->kind, postfix_if->condition)) {
+            return boost::none;
+        }
+        return helper::variant::apply_lambda([this](auto const& n) -> exec_result { return exec(n); }, postfix_if->body);
+    }
+
+    exec_result exec(ast::node::let_stmt const& let)
+    {
+        for (auto const& init : let->inits) {
+            exec(init);
+        }
+        return exec(let->child_stmt);
+    }
+
+    template<class T>
+    exec_result exec(T const&)
+    {
+        fail();
+    }
+    // }}}
+
+public:
+
+    // Note:
+    // Evaluate the expression.  Returns boost::none when it can't be evaluated at compile time.
+    boost::optional<value> evaluate(ast::node::any_expr const& e)
+    {
+        frames.clear();
+        aliased_vars.clear();
+        steps = 0u;
+        allocated_elements = 0u;
+
+        try {
+            return eval(e);
+        }
+        catch (ctfe::not_evaluable const&) {
+            return boost::none;
+        }
+    }
+
+    void define_global_constant(symbol::var_symbol const& sym, value const& v)
+    {
+        global_constants[sym] = v;
+    }
+};
+
+// Note:
+// Fold the results of compile-time function evaluation into the AST.
+// Initializers of global constants are evaluated in the order of definitions.  Invocations
+// of user-defined functions whose arguments are all literals are folded in function bodies.
+// The results are replaced with primary_literal, tuple_literal or array_literal.
+class compile_time_folder {
+    compile_time_evaluator evaluator;
+
+    boost::optional<ast::node::any_expr> to_literal(ctfe::value const& v, type::type const& t, ast::node_type::base const& location) const
+    {
+        auto const make_primary
+            = [&](auto const& raw) -> boost::optional<ast::node::any_expr>
+            {
+                auto const lit = helper::make<ast::node::primary_literal>(raw);
+                lit->type = t;
+                lit->set_source_location(location);
+                return ast::node::any_expr{lit};
+            };
+
+        if (auto const i = boost::get<std::int64_t>(&v)) {
+            // Note:
+            // Integer literal in AST is 32bit
+            if (*i < std::numeric_limits<int>::min() || *i > std::numeric_limits<int>::max() || !t.is_builtin("int")) {
+                return boost::none;
+            }
+            return make_primary(static_cast<int>(*i));
+        } else if (auto const u = boost::get<std::uint64_t>(&v)) {
+            if (*u > std::numeric_limits<unsigned int>::max() || !t.is_builtin("uint")) {
+                return boost::none;
+            }
+            return make_primary(static_cast<unsigned int>(*u));
+        } else if (auto const d = boost::get<double>(&v)) {
+            return make_primary(*d);
+        } else if (auto const b = boost::get<bool>(&v)) {
+            return make_primary(*b);
+        } else if (auto const c = boost::get<char>(&v)) {
+            return make_primary(*c);
+        } else if (auto const s = boost::get<std::string>(&v)) {
+            return make_primary(*s);
+        }
+
+        auto const& elems = boost::get<ctfe::aggregate>(v).elements;
+        if (elems.empty()) {
+            return boost::none;
+        }
+
+        if (auto const tuple_type = type::get<type::tuple_type>(t)) {
+            auto const& elem_types = (*tuple_type)->element_types;
+            if (elem_types.size() != elems.size()) {
+                return boost::none;
+            }
+
+            auto const tuple = helper::make<ast::node::tuple_literal>();
+            for (std::size_t i = 0u; i < elems.size(); ++i) {
+                auto const elem = to_literal(elems[i], elem_types[i], location);
+                if (!elem) {
+                    return boost::none;
+                }
+                tuple->element_exprs.push_back(*elem);
+            }
+            tuple->type = t;
+            tuple->set_source_location(location);
+            return ast::node::any_expr{tuple};
+        } else if (auto const array_type = type::get<type::array_type>(t)) {
+            std::vector<ast::node::any_expr> elem_exprs;
+            for (auto const& e : elems) {
+                auto const elem = to_literal(e, (*array_type)->element_type, location);
+                if (!elem) {
+                    return boost::none;
+                }
+                elem_exprs.push_back(*elem);
+            }
+            auto const array = helper::make<ast::node::array_literal>(elem_exprs);
+            array->type = t;
+            array->set_source_location(location);
+            return ast::node::any_expr{array};
+        }
+
+        return boost::none;
+    }
+
+    static bool is_literal(ast::node::any_expr const& e)
+    {
+        if (helper::variant::has<ast::node::primary_literal>(e)) {
+            return true;
+        } else if (auto const tuple = helper::variant::get_as<ast::node::tuple_literal>(e)) {
+            return boost::algorithm::all_of((*tuple)->element_exprs, [](auto const& elem){ return is_literal(elem); });
+        } else if (auto const array = helper::variant::get_as<ast::node::array_literal>(e)) {
+            return boost::algorithm::all_of((*array)->element_exprs, [](auto const& elem){ return is_literal(elem); });
+        }
+        return false;
+    }
+
+    static bool is_foldable_invocation(ast::node::any_expr const& e)
+    {
+        if (auto const invocation = helper::variant::get_as<ast::node::func_invocation>(e)) {
+            auto const& i = *invocation;
+            return !i->do_block
+                && !i->callee_scope.expired()
+                && !i->callee_scope.lock()->is_builtin
+                && boost::algorithm::all_of(i->args, [](auto const& a){ return is_literal(a); });
+        } else if (auto const ufcs = helper::variant::get_as<ast::node::ufcs_invocation>(e)) {
+            auto const& u = *ufcs;
+            return !u->do_block
+                && !u->callee_scope.expired()
+                && !u->callee_scope.lock()->is_builtin
+                && is_literal(u->child);
+        }
+        return false;
+    }
+
+    bool fold_into(ast::node::any_expr &e, ctfe::value const& v)
+    {
+        auto const t = type::type_of(e);
+        if (!t || t.is_unit()) {
+            return false;
+        }
+
+        auto const location = helper::variant::apply_lambda([](auto const& n) -> ast::node_type::base const* { return n.get(); }, e);
+        auto const literal = to_literal(v, t, *location);
+        if (!literal) {
+            return false;
+        }
+
+        e = *literal;
+        return true;
+    }
+
+    void fold(ast::node::any_expr &e)
+    {
+        if (!is_foldable_invocation(e)) {
+            return;
+        }
+
+        if (auto const result = evaluator.evaluate(e)) {
+            fold_into(e, *result);
+        }
+    }
+
+    template<class Exprs>
+    void fold_all(Exprs &exprs)
+    {
+        for (auto &e : exprs) {
+            fold(e);
+        }
+    }
+
+public:
+
+    void fold_global_constant(ast::node::initialize_stmt const& init)
+    {
+        if (!init->maybe_rhs_exprs) {
+            return;
+        }
+
+        auto &rhs_exprs = *init->maybe_rhs_exprs;
+        auto const& decls = init->var_decls;
+
+        auto const define
+            = [&](ast::node::variable_decl const& decl, ctfe::value const& v)
+            {
+                if (!decl->symbol.expired()) {
+                    evaluator.define_global_constant(decl->symbol.lock(), v);
+                }
+            };
+
+        if (decls.size() == rhs_exprs.size()) {
+            for (std::size_t i = 0u; i < decls.size(); ++i) {
+                auto &rhs = rhs_exprs[i];
+                if (auto const result = evaluator.evaluate(rhs)) {
+                    define(decls[i], *result);
+                    if (!is_literal(rhs)) {
+                        fold_into(rhs, *result);
+                    }
+                }
+            }
+        } else if (rhs_exprs.size() == 1u) {
+            auto &rhs = rhs_exprs[0];
+            if (auto const result = evaluator.evaluate(rhs)) {
+                auto const agg = boost::get<ctfe::aggregate>(&*result);
+                if (agg && agg->elements.size() == decls.size()) {
+                    for (std::size_t i = 0u; i < decls.size(); ++i) {
+                        define(decls[i], agg->elements[i]);
+                    }
+                    if (!is_literal(rhs)) {
+                        fold_into(rhs, *result);
+                    }
+                }
+            }
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::function_definition const& func, Walker const& w)
+    {
+        if (func->is_template()) {
+            for (auto i : func->instantiated) {
+                ast::walk_topdown(i, *this);
+            }
+            return;
+        }
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::func_invocation const& invocation, Walker const& w)
+    {
+        w();
+        fold_all(invocation->args);
+    }
+
+    template<class Walker>
+    void visit(ast::node::ufcs_invocation const& ufcs, Walker const& w)
+    {
+        w();
+        fold(ufcs->child);
+    }
+
+    template<class Walker>
+    void visit(ast::node::binary_expr const& bin_expr, Walker const& w)
+    {
+        w();
+        fold(bin_expr->lhs);
+        fold(bin_expr->rhs);
+    }
+
+    template<class Walker>
+    void visit(ast::node::unary_expr const& unary, Walker const& w)
+    {
+        w();
+        fold(unary->expr);
+    }
+
+    template<class Walker>
+    void visit(ast::node::if_expr const& if_, Walker const& w)
+    {
+        w();
+        fold(if_->condition_expr);
+        fold(if_->then_expr);
+        fold(if_->else_expr);
+    }
+
+    template<class Walker>
+    void visit(ast::node::index_access const& access, Walker const& w)
+    {
+        w();
+        fold(access->child);
+        fold(access->index_expr);
+    }
+
+    template<class Walker>
+    void visit(ast::node::typed_expr const& typed, Walker const& w)
+    {
+        w();
+        fold(typed->child_expr);
+    }
+
+    template<class Walker>
+    void visit(ast::node::cast_expr const& cast, Walker const& w)
+    {
+        w();
+        fold(cast->child);
+    }
+
+    template<class Walker>
+    void visit(ast::node::tuple_literal const& tuple, Walker const& w)
+    {
+        w();
+        fold_all(tuple->element_exprs);
+    }
+
+    template<class Walker>
+    void visit(ast::node::array_literal const& array, Walker const& w)
+    {
+        w();
+        fold_all(array->element_exprs);
+    }
+
+    template<class Walker>
+    void visit(ast::node::initialize_stmt const& init, Walker const& w)
+    {
+        w();
+        if (init->maybe_rhs_exprs) {
+            fold_all(*init->maybe_rhs_exprs);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::assignment_stmt const& assign, Walker const& w)
+    {
+        w();
+        fold_all(assign->rhs_exprs);
+    }
+
+    template<class Walker>
+    void visit(ast::node::return_stmt const& ret, Walker const& w)
+    {
+        w();
+        fold_all(ret->ret_exprs);
+    }
+
+    template<class Walker>
+    void visit(ast::node::if_stmt const& if_, Walker const& w)
+    {
+        w();
+        fold(if_->condition);
+        for (auto &elseif : if_->elseif_stmts_list) {
+            fold(elseif.first);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::while_stmt const& while_, Walker const& w)
+    {
+        w();
+        fold(while_->condition);
+    }
+
+    template<class Walker>
+    void visit(ast::node::for_stmt const& for_, Walker const& w)
+    {
+        w();
+        fold(for_->range_expr);
+    }
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+template<class Node>
+void fold_compile_time_constants(Node &root)
+{
+    compile_time_folder folder;
+
+    for (auto &d : root->definitions) {
+        if (auto const maybe_init = helper::variant::get_as<ast::node::initialize_stmt>(d)) {
+            folder.fold_global_constant(*maybe_init);
+        }
+    }
+
+    for (auto &d : root->definitions) {
+        if (auto maybe_func = helper::variant::get_as<ast::node::function_definition>(d)) {
+            auto func = *maybe_func;
+            ast::walk_topdown(func, folder);
+        }
+    }
+}
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_COMPILE_TIME_EVALUATOR_HPP_INCLUDED
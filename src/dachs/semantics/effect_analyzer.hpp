@@ -0,0 +1,277 @@
+#if !defined DACHS_SEMANTICS_EFFECT_ANALYZER_HPP_INCLUDED
+#define      DACHS_SEMANTICS_EFFECT_ANALYZER_HPP_INCLUDED
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include <boost/algorithm/cxx11/any_of.hpp>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/semantics/scope.hpp"
+#include "dachs/semantics/type.hpp"
+#include "dachs/semantics/semantics_context.hpp"
+#include "dachs/helper/variant.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+// Note:
+// Collect the effect of a function body itself and its callees.
+// Nested lambdas and do-end blocks are not walked because they are separate functions.
+class local_effect_collector {
+    bool writes_through_captures;
+
+    void add_callee(scope::weak_func_scope const& callee)
+    {
+        if (callee.expired()) {
+            return;
+        }
+
+        auto const c = callee.lock();
+        if (c->is_builtin) {
+            // Note:
+            // Built-in functions are print(), println() and push().  print() and println()
+            // write to stdout and push() modifies its receiver array.
+            effect = function_effect::impure;
+        } else {
+            callees.push_back(c);
+        }
+    }
+
+    void raise_effect(function_effect const e) noexcept
+    {
+        effect = std::max(effect, e);
+    }
+
+    static bool is_dynamic_array(type::type const& t)
+    {
+        auto const array = type::get<type::array_type>(t);
+        return array && !(*array)->size;
+    }
+
+    // Note:
+    // Strings and symbols are pointers to their characters.
+    static bool is_string(type::type const& t)
+    {
+        return t.is_builtin("string") || t.is_builtin("symbol");
+    }
+
+    // Note:
+    // Comparing values of these types dereferences pointers in them.  e.g. strings are
+    // compared by strcmp() and a string case statement hashes its target.
+    static bool contains_pointer(type::type const& t)
+    {
+        if (auto const tuple = type::get<type::tuple_type>(t)) {
+            return boost::algorithm::any_of((*tuple)->element_types, [](auto const& e){ return contains_pointer(type::type{e}); });
+        } else if (auto const array = type::get<type::array_type>(t)) {
+            return !(*array)->size || contains_pointer(type::type{(*array)->element_type});
+        } else {
+            return is_string(t);
+        }
+    }
+
+    // Note:
+    // Elements of dynamic arrays are in heap.  Dynamic arrays have reference semantics.
+    static bool is_element_of_dynamic_array(ast::node::any_expr const& e)
+    {
+        if (auto const access = helper::variant::get_as<ast::node::index_access>(e)) {
+            return is_dynamic_array(type::type_of((*access)->child))
+                || is_element_of_dynamic_array((*access)->child);
+        }
+        return false;
+    }
+
+    static bool is_element_of_capture(ast::node::any_expr const& e)
+    {
+        if (auto const access = helper::variant::get_as<ast::node::index_access>(e)) {
+            return helper::variant::has<ast::node::ufcs_invocation>((*access)->child)
+                || is_element_of_capture((*access)->child);
+        }
+        return false;
+    }
+
+public:
+
+    function_effect effect = function_effect::pure;
+    std::vector<scope::func_scope> callees;
+
+    explicit local_effect_collector(bool const has_captures_by_reference) noexcept
+        : writes_through_captures(has_captures_by_reference)
+    {
+        if (has_captures_by_reference) {
+            // Note:
+            // Captured aggregates are read through pointers to the memory of the enclosing function.
+            effect = function_effect::readonly;
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::func_invocation const& invocation, Walker const& w)
+    {
+        w();
+        add_callee(invocation->callee_scope);
+    }
+
+    template<class Walker>
+    void visit(ast::node::ufcs_invocation const& ufcs, Walker const& w)
+    {
+        w();
+        if (ufcs->callee_scope.expired()) {
+            auto const child_type = type::type_of(ufcs->child);
+            if (is_dynamic_array(child_type) || is_string(child_type)) {
+                // Note:
+                // Reads the length of the dynamic array or the string
+                raise_effect(function_effect::readonly);
+            }
+        }
+        add_callee(ufcs->callee_scope);
+    }
+
+    template<class Walker>
+    void visit(ast::node::index_access const& access, Walker const& w)
+    {
+        w();
+        auto const child_type = type::type_of(access->child);
+        if (is_dynamic_array(child_type) || is_string(child_type)) {
+            raise_effect(function_effect::readonly);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::binary_expr const& bin_expr, Walker const& w)
+    {
+        w();
+        if (contains_pointer(type::type_of(bin_expr->lhs)) || contains_pointer(type::type_of(bin_expr->rhs))) {
+            raise_effect(function_effect::readonly);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::switch_stmt const& switch_, Walker const& w)
+    {
+        w();
+        if (contains_pointer(type::type_of(switch_->target_expr))) {
+            raise_effect(function_effect::readonly);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::object_construct const& obj, Walker const& w)
+    {
+        w();
+        if (is_dynamic_array(obj->type)) {
+            // Note:
+            // Dynamic arrays are allocated by libdachs
+            raise_effect(function_effect::impure);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::assignment_stmt const& assign, Walker const& w)
+    {
+        w();
+        if (writes_through_captures
+                && boost::algorithm::any_of(assign->assignees, [](auto const& a){ return is_element_of_capture(a); })) {
+            effect = function_effect::impure;
+        }
+        if (boost::algorithm::any_of(assign->assignees, [](auto const& a){ return is_element_of_dynamic_array(a); })) {
+            effect = function_effect::impure;
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::function_definition const&, Walker const&)
+    {}
+
+    template<class Walker>
+    void visit(ast::node::lambda_expr const&, Walker const&)
+    {}
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+// Note:
+// Classify functions into pure (no memory access except for its own stack), read-only and impure.
+// The effect of a function is the strongest one among its own effect and effects of its callees.
+// It is calculated as the least fixed point over the call graph, so recursive functions can be pure.
+template<class Node>
+function_effects_type analyze_function_effects(
+        Node const& root,
+        lambda_captures_type const& captures,
+        non_escaping_lambdas_type const& non_escaping_lambdas)
+{
+    std::vector<ast::node::function_definition> funcs;
+    for (auto const& d : root->definitions) {
+        if (auto const maybe_func = helper::variant::get_as<ast::node::function_definition>(d)) {
+            auto const& f = *maybe_func;
+            if (f->is_template()) {
+                funcs.insert(std::end(funcs), std::begin(f->instantiated), std::end(f->instantiated));
+            } else {
+                funcs.push_back(f);
+            }
+        }
+    }
+
+    std::unordered_map<scope::func_scope, local_effect_collector> locals;
+    function_effects_type effects;
+
+    for (auto const& f : funcs) {
+        if (f->scope.expired()) {
+            continue;
+        }
+        auto const scope = f->scope.lock();
+
+        bool has_captures_by_reference = false;
+        auto const found = captures.find(scope);
+        if (found != std::end(captures)) {
+            has_captures_by_reference
+                = boost::algorithm::any_of(
+                        found->second,
+                        [&](auto const& c){ return is_captured_by_reference(non_escaping_lambdas, scope, c); }
+                    );
+        }
+
+        local_effect_collector collector{has_captures_by_reference};
+        auto body = f->body;
+        ast::walk_topdown(body, collector);
+
+        effects[scope] = collector.effect;
+        locals.emplace(scope, std::move(collector));
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto const& l : locals) {
+            auto &effect = effects[l.first];
+            auto new_effect = effect;
+            for (auto const& callee : l.second.callees) {
+                auto const callee_effect = effects.find(callee);
+                new_effect = std::max(
+                        new_effect,
+                        callee_effect == std::end(effects) ? function_effect::impure : callee_effect->second
+                    );
+            }
+
+            if (new_effect != effect) {
+                effect = new_effect;
+                changed = true;
+            }
+        }
+    }
+
+    return effects;
+}
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_EFFECT_ANALYZER_HPP_INCLUDED
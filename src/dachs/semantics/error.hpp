@@ -27,9 +27,9 @@ inline void output_semantic_error(std::shared_ptr<Node> const& node, Message con
 }
 
 template<class Node1, class Node2>
-void print_duplication_error(Node1 const& node1, Node2 const& node2, std::string const& name) noexcept
+void print_duplication_error(Node1 const& node1, Node2 const& node2, std::string const& name, std::ostream &ost = std::cerr) noexcept
 {
-    output_semantic_error(node1, boost::format("Symbol '%1%' is redefined.\nPrevious definition is at line:%2%, col:%3%") % name % node2->line % node2->col);
+    output_semantic_error(node1, boost::format("Symbol '%1%' is redefined.\nPrevious definition is at line:%2%, col:%3%") % name % node2->line % node2->col, ost);
 }
 
 } // namespace semantics
@@ -41,6 +41,22 @@ scope::scope_tree analyze_symbols_forward(ast::ast &a)
             scope_root->define_global_function_constant(std::move(func_var_sym));
         }
 
+        {
+            // func push(array, value)
+            auto push_func = scope::make<scope::func_scope>(nullptr, scope_root, "push", true);
+            push_func->body = scope::make<scope::local_scope>(push_func);
+            push_func->ret_type = type::get_unit_type();
+            for (auto const& name : {"array", "value"}) {
+                auto p = symbol::make<symbol::var_symbol>(nullptr, name, true, true);
+                p->type = dummy_template_type;
+                push_func->define_param(std::move(p));
+            }
+            scope_root->define_function(push_func);
+            auto func_var_sym = symbol::make<symbol::var_symbol>(nullptr, "push", true, true);
+            func_var_sym->type = type::make<type::generic_func_type>(push_func);
+            scope_root->define_global_function_constant(std::move(func_var_sym));
+        }
+
         // Operators
         // cast functions
     }
@@ -0,0 +1,362 @@
+#if !defined DACHS_SEMANTICS_LAMBDA_ESCAPE_ANALYZER_HPP_INCLUDED
+#define      DACHS_SEMANTICS_LAMBDA_ESCAPE_ANALYZER_HPP_INCLUDED
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+#include <unordered_set>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/semantics/symbol.hpp"
+#include "dachs/semantics/scope.hpp"
+#include "dachs/semantics/type.hpp"
+#include "dachs/semantics/semantics_context.hpp"
+#include "dachs/helper/variant.hpp"
+#include "dachs/helper/util.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+using std::size_t;
+using helper::variant::get_as;
+
+// Note:
+// Escape analysis for lambda objects of do-end blocks.
+// A lambda object of do-end block is generated at the invocation and passed to the callee.
+// It doesn't escape when the callee only invokes the parameter or passes it to other functions
+// whose parameters don't escape.  It escapes when it is returned, stored in a variable,
+// captured by other lambda or put into other objects.
+class lambda_escape_analyzer {
+    lambda_captures_type const& captures;
+    std::unordered_set<symbol::var_symbol> captured_symbols;
+    using param_key_type = std::pair<scope::func_scope, size_t>;
+    std::map<param_key_type, bool> param_escapes_cache;
+    std::map<param_key_type, bool> unresolved_param_escapes;
+    non_escaping_lambdas_type non_escaping_lambdas;
+
+    class param_use_checker {
+        lambda_escape_analyzer &analyzer;
+        symbol::var_symbol const& param;
+
+        bool is_param(ast::node::any_expr const& e) const
+        {
+            auto const var = get_as<ast::node::var_ref>(e);
+            return var && !(*var)->symbol.expired() && (*var)->symbol.lock() == param;
+        }
+
+        template<class Node>
+        void walk(Node const& n)
+        {
+            auto node = n;
+            ast::walk_topdown(node, *this);
+        }
+
+        template<class Callee>
+        void check_passed_param(Callee const& callee, size_t const idx)
+        {
+            if (callee.expired() || analyzer.param_escapes(callee.lock(), idx)) {
+                escapes = true;
+            }
+        }
+
+    public:
+
+        bool escapes = false;
+
+        param_use_checker(lambda_escape_analyzer &a, symbol::var_symbol const& p) noexcept
+            : analyzer(a), param(p)
+        {}
+
+        template<class Walker>
+        void visit(ast::node::var_ref const& var, Walker const&)
+        {
+            if (!var->symbol.expired() && var->symbol.lock() == param) {
+                // Note:
+                // Used as a value other than the callee or an argument of invocation
+                escapes = true;
+            }
+        }
+
+        template<class Walker>
+        void visit(ast::node::func_invocation const& invocation, Walker const&)
+        {
+            if (!is_param(invocation->child)) {
+                walk(invocation->child);
+            }
+
+            for (auto const idx : helper::indices(invocation->args.size())) {
+                auto const& arg = invocation->args[idx];
+                if (is_param(arg)) {
+                    check_passed_param(invocation->callee_scope, idx);
+                } else {
+                    walk(arg);
+                }
+            }
+        }
+
+        template<class Walker>
+        void visit(ast::node::ufcs_invocation const& ufcs, Walker const&)
+        {
+            if (!is_param(ufcs->child)) {
+                walk(ufcs->child);
+                return;
+            }
+
+            if (!ufcs->callee_scope.expired()) {
+                // Note:
+                // a.foo means foo(a)
+                check_passed_param(ufcs->callee_scope, 0u);
+            }
+        }
+
+        template<class Walker>
+        void visit(ast::node::lambda_expr const&, Walker const&)
+        {
+            // Note:
+            // Lambda bodies are separate functions.  Captures in them are checked with
+            // captured symbols.
+        }
+
+        template<class T, class Walker>
+        void visit(T const&, Walker const& w)
+        {
+            if (!escapes) {
+                w();
+            }
+        }
+    };
+
+    // Note:
+    // Collects captures modified in the body of lambda.  'a = x', 'a[i] = x' and
+    // 'a.push(x)' modify the capture 'a'.
+    class capture_write_checker {
+        std::unordered_set<ast::node::ufcs_invocation> &written;
+
+        void mark_written(ast::node::any_expr const& e)
+        {
+            if (auto const ufcs = get_as<ast::node::ufcs_invocation>(e)) {
+                written.insert(*ufcs);
+            } else if (auto const access = get_as<ast::node::index_access>(e)) {
+                mark_written((*access)->child);
+            } else if (auto const typed = get_as<ast::node::typed_expr>(e)) {
+                mark_written((*typed)->child_expr);
+            }
+        }
+
+    public:
+
+        explicit capture_write_checker(std::unordered_set<ast::node::ufcs_invocation> &w) noexcept
+            : written(w)
+        {}
+
+        template<class Walker>
+        void visit(ast::node::assignment_stmt const& assign, Walker const& w)
+        {
+            for (auto const& a : assign->assignees) {
+                mark_written(a);
+            }
+            w();
+        }
+
+        template<class Walker>
+        void visit(ast::node::func_invocation const& invocation, Walker const& w)
+        {
+            if (!invocation->callee_scope.expired() && !invocation->args.empty()) {
+                auto const callee = invocation->callee_scope.lock();
+                if (callee->is_builtin && callee->name == "push") {
+                    mark_written(invocation->args[0]);
+                }
+            }
+            w();
+        }
+
+        template<class T, class Walker>
+        void visit(T const&, Walker const& w)
+        {
+            w();
+        }
+    };
+
+    std::unordered_set<size_t> written_capture_offsets(scope::func_scope const& lambda) const
+    {
+        std::unordered_set<size_t> offsets;
+        auto const found = captures.find(lambda);
+        if (found == std::end(captures)) {
+            return offsets;
+        }
+
+        std::unordered_set<ast::node::ufcs_invocation> written;
+        auto body = lambda->get_ast_node()->body;
+        capture_write_checker checker{written};
+        ast::walk_topdown(body, checker);
+
+        for (auto const& c : found->second) {
+            if (helper::exists(written, c.introduced)) {
+                offsets.insert(c.offset);
+            }
+        }
+        return offsets;
+    }
+
+    bool check_param_escapes(scope::func_scope const& callee, size_t const idx)
+    {
+        auto const& param = callee->params[idx];
+        if (captured_symbols.find(param) != std::end(captured_symbols)) {
+            return true;
+        }
+
+        param_use_checker checker{*this, param};
+        auto body = callee->get_ast_node()->body;
+        ast::walk_topdown(body, checker);
+        return checker.escapes;
+    }
+
+    // Note:
+    // Parameters of mutually recursive functions depend on each other.  They are resolved
+    // together by iterating to a fixed point.  All parameters found while resolving start
+    // from "doesn't escape" and are only flipped to "escapes".  The results are cached after
+    // no more parameter is flipped, so no result depending on an assumption is cached.
+    bool param_escapes(scope::func_scope const& callee, size_t const idx)
+    {
+        if (callee->is_builtin || callee->is_anonymous() || callee->is_template() || idx >= callee->params.size()) {
+            return true;
+        }
+
+        auto const key = std::make_pair(callee, idx);
+        auto const cached = param_escapes_cache.find(key);
+        if (cached != std::end(param_escapes_cache)) {
+            return cached->second;
+        }
+
+        auto const unresolved = unresolved_param_escapes.find(key);
+        if (unresolved != std::end(unresolved_param_escapes)) {
+            return unresolved->second;
+        }
+
+        if (!unresolved_param_escapes.empty()) {
+            // Note:
+            // Found while resolving other parameters.  It is checked in the next iteration.
+            unresolved_param_escapes.emplace(key, false);
+            return false;
+        }
+
+        unresolved_param_escapes.emplace(key, false);
+
+        bool changed = true;
+        while (changed) {
+            std::vector<param_key_type> keys;
+            for (auto const& u : unresolved_param_escapes) {
+                if (!u.second) {
+                    keys.push_back(u.first);
+                }
+            }
+
+            auto const num_params = unresolved_param_escapes.size();
+            changed = false;
+            for (auto const& k : keys) {
+                if (check_param_escapes(k.first, k.second)) {
+                    unresolved_param_escapes[k] = true;
+                    changed = true;
+                }
+            }
+
+            if (unresolved_param_escapes.size() != num_params) {
+                changed = true;
+            }
+        }
+
+        param_escapes_cache.insert(std::begin(unresolved_param_escapes), std::end(unresolved_param_escapes));
+        unresolved_param_escapes.clear();
+        return param_escapes_cache[key];
+    }
+
+    template<class Callee>
+    void check_do_block_object(type::type const& object_type, Callee const& callee, size_t const idx)
+    {
+        auto const g = type::get<type::generic_func_type>(object_type);
+        if (!g || !(*g)->ref || (*g)->ref->expired() || callee.expired()) {
+            return;
+        }
+
+        if (!param_escapes(callee.lock(), idx)) {
+            auto const lambda = (*g)->ref->lock();
+            if (!helper::exists(non_escaping_lambdas, lambda)) {
+                non_escaping_lambdas.emplace(lambda, written_capture_offsets(lambda));
+            }
+        }
+    }
+
+public:
+
+    explicit lambda_escape_analyzer(lambda_captures_type const& cs_map)
+        : captures(cs_map)
+    {
+        for (auto const& cs : captures) {
+            for (auto const& c : cs.second) {
+                if (!c.refered_symbol.expired()) {
+                    captured_symbols.insert(c.refered_symbol.lock());
+                }
+            }
+        }
+    }
+
+    auto const& get_non_escaping_lambdas() const noexcept
+    {
+        return non_escaping_lambdas;
+    }
+
+    template<class Walker>
+    void visit(ast::node::function_definition const& func, Walker const& w)
+    {
+        if (func->is_template()) {
+            for (auto i : func->instantiated) {
+                ast::walk_topdown(i, *this);
+            }
+            return;
+        }
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::func_invocation const& invocation, Walker const& w)
+    {
+        w();
+        if (invocation->do_block && !invocation->args.empty()) {
+            check_do_block_object(type::type_of(invocation->args.back()), invocation->callee_scope, invocation->args.size() - 1);
+        }
+    }
+
+    template<class Walker>
+    void visit(ast::node::ufcs_invocation const& ufcs, Walker const& w)
+    {
+        w();
+        if (ufcs->do_block && ufcs->do_block_object) {
+            // Note:
+            // a.foo do ... end means foo(a, lambda)
+            check_do_block_object((*ufcs->do_block_object)->type, ufcs->callee_scope, 1u);
+        }
+    }
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+template<class Node>
+non_escaping_lambdas_type analyze_lambda_escapes(Node &root, lambda_captures_type const& captures)
+{
+    lambda_escape_analyzer analyzer{captures};
+    ast::walk_topdown(root, analyzer);
+    return analyzer.get_non_escaping_lambdas();
+}
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_LAMBDA_ESCAPE_ANALYZER_HPP_INCLUDED
@@ -0,0 +1,170 @@
+#if !defined DACHS_SEMANTICS_LAST_USE_ANALYZER_HPP_INCLUDED
+#define      DACHS_SEMANTICS_LAST_USE_ANALYZER_HPP_INCLUDED
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/semantics/symbol.hpp"
+#include "dachs/semantics/semantics_context.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+// Note:
+// Last-use analysis of mutable variables.  A mutable variable owns its memory because it is
+// deep-copied on definition.  A reference to the variable is its last use when
+//   - it is the only reference to the variable,
+//   - the variable is not captured by any lambda, and
+//   - it is in the same loop as the definition of the variable.
+// The memory of the variable can be moved to another variable at its last use instead of
+// being deep-copied because nobody observes the variable after that.
+class last_use_analyzer {
+    struct var_info {
+        void const* defined_loop = nullptr;
+        bool defined = false;
+        std::size_t num_refs = 0u;
+        ast::node::var_ref ref;
+        void const* referred_loop = nullptr;
+    };
+
+    std::unordered_set<symbol::var_symbol> captured_symbols;
+    std::unordered_map<symbol::var_symbol, var_info> vars;
+    void const* current_loop = nullptr;
+
+    void define(symbol::weak_var_symbol const& weak)
+    {
+        if (weak.expired()) {
+            return;
+        }
+
+        auto const sym = weak.lock();
+        if (sym->immutable) {
+            return;
+        }
+
+        auto &info = vars[sym];
+        info.defined = true;
+        info.defined_loop = current_loop;
+    }
+
+    template<class Loop, class Walker>
+    void walk_in_loop(Loop const& loop, Walker const& w)
+    {
+        auto const outer_loop = current_loop;
+        current_loop = loop.get();
+        w();
+        current_loop = outer_loop;
+    }
+
+public:
+
+    explicit last_use_analyzer(lambda_captures_type const& captures)
+    {
+        for (auto const& cs : captures) {
+            for (auto const& c : cs.second) {
+                if (!c.refered_symbol.expired()) {
+                    captured_symbols.insert(c.refered_symbol.lock());
+                }
+            }
+        }
+    }
+
+    last_uses_type get_last_uses() const
+    {
+        last_uses_type last_uses;
+        for (auto const& v : vars) {
+            auto const& info = v.second;
+            if (info.defined
+                    && info.num_refs == 1u
+                    && info.defined_loop == info.referred_loop
+                    && captured_symbols.find(v.first) == std::end(captured_symbols)) {
+                last_uses.insert(info.ref);
+            }
+        }
+        return last_uses;
+    }
+
+    template<class Walker>
+    void visit(ast::node::function_definition const& func, Walker const& w)
+    {
+        if (func->is_template()) {
+            for (auto i : func->instantiated) {
+                ast::walk_topdown(i, *this);
+            }
+            return;
+        }
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::parameter const& param, Walker const& w)
+    {
+        define(param->param_symbol);
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::variable_decl const& decl, Walker const& w)
+    {
+        define(decl->symbol);
+        w();
+    }
+
+    template<class Walker>
+    void visit(ast::node::var_ref const& var, Walker const& w)
+    {
+        w();
+        if (var->symbol.expired()) {
+            return;
+        }
+
+        auto const sym = var->symbol.lock();
+        if (sym->immutable) {
+            return;
+        }
+
+        auto &info = vars[sym];
+        ++info.num_refs;
+        info.ref = var;
+        info.referred_loop = current_loop;
+    }
+
+    template<class Walker>
+    void visit(ast::node::while_stmt const& while_, Walker const& w)
+    {
+        walk_in_loop(while_, w);
+    }
+
+    template<class Walker>
+    void visit(ast::node::for_stmt const& for_, Walker const& w)
+    {
+        // Note:
+        // The range expression is evaluated only once.  But it is regarded as in the loop
+        // for simplicity.  It only makes the analysis conservative.
+        walk_in_loop(for_, w);
+    }
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+template<class Node>
+last_uses_type analyze_last_uses(Node &root, lambda_captures_type const& captures)
+{
+    last_use_analyzer analyzer{captures};
+    ast::walk_topdown(root, analyzer);
+    return analyzer.get_last_uses();
+}
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_LAST_USE_ANALYZER_HPP_INCLUDED
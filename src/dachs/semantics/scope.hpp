@@ -3,8 +3,10 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <type_traits>
 #include <cstddef>
+#include <iostream>
 #include <boost/variant/variant.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -39,6 +41,10 @@ struct basic_scope {
     // Or should I?
     scope::enclosing_scope_type enclosing_scope;
 
+    // Note:
+    // Hashed index from the name of variable to its slot in the symbol vector.
+    using symbol_index_type = std::unordered_map<std::string, std::size_t>;
+
     template<class AnyScope>
     explicit basic_scope(AnyScope const& parent) noexcept
         : enclosing_scope(parent)
@@ -63,6 +69,30 @@ struct basic_scope {
         return true;
     }
 
+    // Note:
+    // Variables are compared by their names.  So the hashed index is enough to check duplication.
+    bool define_indexed_symbol(std::vector<symbol::var_symbol> &container, symbol_index_type &index, symbol::var_symbol const& symbol, std::ostream &ost = std::cerr)
+    {
+        auto const duplication = index.find(symbol->name);
+        if (duplication != std::end(index)) {
+            semantics::print_duplication_error(symbol->ast_node.get_shared(), container[duplication->second]->ast_node.get_shared(), symbol->name, ost);
+            return false;
+        }
+        index.emplace(symbol->name, container.size());
+        container.push_back(symbol);
+        return true;
+    }
+
+    boost::optional<symbol::var_symbol>
+    lookup_indexed_symbol(std::vector<symbol::var_symbol> const& container, symbol_index_type const& index, std::string const& name) const
+    {
+        auto const found = index.find(name);
+        if (found == std::end(index)) {
+            return boost::none;
+        }
+        return container[found->second];
+    }
+
     // TODO resolve member variables and member functions
 
     virtual boost::optional<scope::func_scope>
@@ -109,7 +139,7 @@ struct basic_scope {
                 }, enclosing_scope);
     }
 
-    void check_shadowing_variable(symbol::var_symbol new_var) const
+    void check_shadowing_variable(symbol::var_symbol new_var, std::ostream &ost = std::cerr) const
     {
         auto const maybe_shadowing_var = apply_lambda(
                 [&new_var](auto const& s)
@@ -124,6 +154,7 @@ struct basic_scope {
             output_warning(the_node, boost::format(
                             "Shadowing variable '%1%'. It shadows a variable at line:%2%, col:%3%"
                         ) % new_var->name % prev_node->line % prev_node->col
+                    , ost
                     );
         }
     }
@@ -132,6 +163,7 @@ struct basic_scope {
 struct global_scope final : public basic_scope {
     std::vector<scope::func_scope> functions;
     std::vector<symbol::var_symbol> const_symbols;
+    symbol_index_type const_symbol_index;
     std::vector<scope::class_scope> classes;
     std::weak_ptr<ast::node_type::inu> ast_root;
 
@@ -147,16 +179,18 @@ struct global_scope final : public basic_scope {
         functions.push_back(new_func);
     }
 
-    bool define_variable(symbol::var_symbol const& new_var) noexcept
+    bool define_variable(symbol::var_symbol const& new_var, std::ostream &ost = std::cerr)
     {
-        return define_symbol(const_symbols, new_var);
+        return define_indexed_symbol(const_symbols, const_symbol_index, new_var, ost);
     }
 
     // Note:
     // Do not check duplication because of overloaded functions.  Check for overloaded functions
     // is already done by define_function()
-    void define_global_function_constant(symbol::var_symbol const& new_var) noexcept
+    // The index refers to the first one among overloaded function constants.
+    void define_global_function_constant(symbol::var_symbol const& new_var)
     {
+        const_symbol_index.emplace(new_var->name, const_symbols.size());
         const_symbols.push_back(new_var);
     }
 
@@ -175,13 +209,14 @@ struct global_scope final : public basic_scope {
 
     boost::optional<symbol::var_symbol> resolve_var(std::string const& name) const override
     {
-        return helper::find_if(const_symbols, [&name](auto const& v){ return v->name == name; });
+        return lookup_indexed_symbol(const_symbols, const_symbol_index, name);
     }
 };
 
 struct local_scope final : public basic_scope {
     std::vector<scope::local_scope> children;
     std::vector<symbol::var_symbol> local_vars;
+    symbol_index_type local_var_index;
     std::vector<scope::func_scope> unnamed_funcs;
 
     template<class AnyScope>
@@ -194,10 +229,10 @@ struct local_scope final : public basic_scope {
         children.push_back(child);
     }
 
-    bool define_variable(symbol::var_symbol const& new_var) noexcept
+    bool define_variable(symbol::var_symbol const& new_var, std::ostream &ost = std::cerr)
     {
-        check_shadowing_variable(new_var);
-        return define_symbol(local_vars, new_var);
+        check_shadowing_variable(new_var, ost);
+        return define_indexed_symbol(local_vars, local_var_index, new_var, ost);
     }
 
     bool define_unnamed_func(scope::func_scope const& new_func) noexcept
@@ -207,16 +242,17 @@ struct local_scope final : public basic_scope {
 
     boost::optional<symbol::var_symbol> resolve_var(std::string const& name) const override
     {
-        auto const target_var = helper::find_if(local_vars, [&name](auto const& v){ return v->name == name; });
+        auto const target_var = lookup_indexed_symbol(local_vars, local_var_index, name);
         return target_var ?
-                *target_var :
-                apply_lambda([&name](auto const& s){ return s.lock()->resolve_var(name); }, enclosing_scope);
+                target_var :
+                basic_scope::resolve_var(name);
     }
 };
 
 struct func_scope final : public basic_scope, public symbol_node::basic_symbol {
     scope::local_scope body;
     std::vector<symbol::var_symbol> params;
+    symbol_index_type param_index;
     boost::optional<type::type> ret_type;
 
     template<class Node, class P>
@@ -227,15 +263,22 @@ struct func_scope final : public basic_scope, public symbol_node::basic_symbol {
 
     func_scope(func_scope const&) = default;
 
-    bool define_param(symbol::var_symbol const& new_var) noexcept
+    bool define_param(symbol::var_symbol const& new_var)
     {
         check_shadowing_variable(new_var);
-        return define_symbol(params, new_var);
+        return define_indexed_symbol(params, param_index, new_var);
     }
 
-    void force_push_front_param(symbol::var_symbol const& new_param) noexcept
+    void force_push_front_param(symbol::var_symbol const& new_param)
     {
         params.insert(std::begin(params), new_param);
+
+        // Note:
+        // All slots of existing parameters are shifted by the new parameter
+        for (auto &i : param_index) {
+            ++i.second;
+        }
+        param_index.emplace(new_param->name, 0u);
     }
 
     bool is_template() const noexcept
@@ -259,13 +302,10 @@ struct func_scope final : public basic_scope, public symbol_node::basic_symbol {
 
     boost::optional<symbol::var_symbol> resolve_var(std::string const& name) const override
     {
-        auto const target_var = helper::find_if(params, [&name](auto const& v){ return v->name == name; });
+        auto const target_var = lookup_indexed_symbol(params, param_index, name);
         return target_var ?
-                *target_var :
-                apply_lambda([&name](auto const& s)
-                        {
-                            return s.lock()->resolve_var(name);
-                        }, enclosing_scope);
+                target_var :
+                basic_scope::resolve_var(name);
     }
 
     boost::optional<symbol::var_symbol> resolve_receiver() const override
@@ -3,10 +3,13 @@
 
 #include <cstddef>
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <utility>
 #include <string>
+#include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -15,6 +18,7 @@
 #include "dachs/semantics/scope.hpp"
 #include "dachs/semantics/symbol.hpp"
 #include "dachs/ast/ast_fwd.hpp"
+#include "dachs/helper/util.hpp"
 
 namespace dachs {
 namespace semantics {
@@ -49,11 +53,70 @@ using captured_offset_map
             >
         >;
 using lambda_captures_type = std::unordered_map<scope::func_scope, captured_offset_map>;
+// Note:
+// Lambda objects of do-end blocks which never outlive their creators -> Offsets of
+// captures which are modified in the lambda.
+using non_escaping_lambdas_type = std::unordered_map<scope::func_scope, std::unordered_set<std::size_t>>;
+
+// Note:
+// Lambda objects which never outlive their creators refer captured aggregates through
+// pointers to the creator's variables instead of copying them.  Captures modified in the
+// lambda are still copied because the modification must not be visible to the creator.
+template<class Lambda>
+inline bool is_captured_by_reference(non_escaping_lambdas_type const& non_escaping, Lambda const& lambda, lambda_capture const& capture)
+{
+    auto const found = non_escaping.find(lambda);
+    if (found == std::end(non_escaping) || helper::exists(found->second, capture.offset)) {
+        return false;
+    }
+
+    auto const& t = capture.introduced->type;
+    return type::is_a<type::tuple_type>(t) || type::is_a<type::array_type>(t);
+}
+
+// Note:
+// Effects of functions ordered by strength.
+//   pure     : Doesn't access any memory except for its own stack.
+//   readonly : Reads memory of other functions (e.g. captures by reference) but never writes.
+//   impure   : Writes memory or does I/O.
+enum class function_effect {
+    pure,
+    readonly,
+    impure,
+};
+
+using function_effects_type = std::unordered_map<scope::func_scope, function_effect>;
+
+// Note:
+// References to mutable variables which are never used after the references.
+// The memory of the variables can be moved instead of being deep-copied.
+using last_uses_type = std::unordered_set<ast::node::var_ref>;
+
+// Note:
+// Index accesses whose indices are provably in bounds of the arrays.
+using in_bounds_accesses_type = std::unordered_set<ast::node::index_access>;
+
+// Note:
+// Self-recursive calls in return statements of a function.  They are lowered to a loop.
+// When the results of the calls are accumulated by the same operator ('+' or '*' of int or uint)
+// like 'ret n * fact(n - 1)', the operator is recorded as the accumulator of the loop.
+struct tail_recursion {
+    std::unordered_set<ast::node::func_invocation> calls;
+    boost::optional<std::string> accumulator;
+};
+
+using tail_recursions_type = std::unordered_map<scope::func_scope, tail_recursion>;
 
 struct semantics_context {
     scope::scope_tree scopes;
     lambda_captures_type lambda_captures;
     std::unordered_map<type::generic_func_type, ast::node::tuple_literal> lambda_instantiation_map;
+    non_escaping_lambdas_type non_escaping_lambdas;
+    std::vector<ast::node::function_definition> dropped_functions;
+    function_effects_type function_effects;
+    last_uses_type last_uses;
+    in_bounds_accesses_type in_bounds_accesses;
+    tail_recursions_type tail_recursions;
 
     semantics_context(semantics_context const&) = delete;
     semantics_context &operator=(semantics_context const&) = delete;
@@ -71,6 +134,15 @@ struct semantics_context {
             }
         }
     }
+
+    template<class Stream = std::ostream>
+    void dump_dropped_functions(Stream &out = std::cerr) const noexcept
+    {
+        out << "Dropped functions (unreachable from main):" << std::endl;
+        for (auto const& f : dropped_functions) {
+            out << "  " << f->name << ':' << f->line << ':' << f->col << std::endl;
+        }
+    }
 };
 
 } // namespace semantics
@@ -0,0 +1,208 @@
+#if !defined DACHS_SEMANTICS_TAIL_RECURSION_ANALYZER_HPP_INCLUDED
+#define      DACHS_SEMANTICS_TAIL_RECURSION_ANALYZER_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <boost/optional.hpp>
+
+#include "dachs/ast/ast.hpp"
+#include "dachs/ast/ast_walker.hpp"
+#include "dachs/semantics/scope.hpp"
+#include "dachs/semantics/type.hpp"
+#include "dachs/semantics/semantics_context.hpp"
+#include "dachs/helper/variant.hpp"
+
+namespace dachs {
+namespace semantics {
+namespace detail {
+
+using helper::variant::get_as;
+
+// Note:
+// Finds self-recursive calls in return statements.
+//   ret f(x)          : The call is replaced with a jump to the beginning of the function.
+//   ret n * f(x)      : The result is accumulated.  Only '+' and '*' of int and uint are
+//   ret f(x) + n        accumulated because they are associative and commutative.
+// The other operand of an accumulation must not contain any invocation because it is
+// evaluated before the recursive call in the loop.
+class tail_recursion_analyzer {
+    class invocation_finder {
+    public:
+
+        bool found = false;
+
+        template<class Walker>
+        void visit(ast::node::func_invocation const&, Walker const&)
+        {
+            found = true;
+        }
+
+        template<class Walker>
+        void visit(ast::node::ufcs_invocation const&, Walker const&)
+        {
+            found = true;
+        }
+
+        template<class Walker>
+        void visit(ast::node::object_construct const&, Walker const&)
+        {
+            found = true;
+        }
+
+        template<class T, class Walker>
+        void visit(T const&, Walker const& w)
+        {
+            w();
+        }
+    };
+
+    struct function_state {
+        scope::func_scope scope;
+        tail_recursion recursion;
+        std::vector<std::pair<ast::node::func_invocation, std::string>> accumulations;
+    };
+
+    tail_recursions_type tail_recursions;
+    boost::optional<function_state> current;
+
+    static bool contains_invocation(ast::node::any_expr const& e)
+    {
+        auto expr = e;
+        invocation_finder finder;
+        ast::walk_topdown(expr, finder);
+        return finder.found;
+    }
+
+    boost::optional<ast::node::func_invocation> self_call_of(ast::node::any_expr const& e) const
+    {
+        auto const invocation = get_as<ast::node::func_invocation>(e);
+        if (!invocation
+                || (*invocation)->do_block
+                || (*invocation)->callee_scope.expired()
+                || (*invocation)->callee_scope.lock() != current->scope) {
+            return boost::none;
+        }
+        return *invocation;
+    }
+
+    void record_accumulation(ast::node::binary_expr const& bin_expr)
+    {
+        if (bin_expr->op != "+" && bin_expr->op != "*") {
+            return;
+        }
+
+        auto const& t = bin_expr->type;
+        if (!t.is_builtin("int") && !t.is_builtin("uint")) {
+            return;
+        }
+
+        auto const record
+            = [&, this](auto const& self_call, auto const& other)
+            {
+                if (!self_call || contains_invocation(other)) {
+                    return false;
+                }
+                current->accumulations.emplace_back(*self_call, bin_expr->op);
+                return true;
+            };
+
+        record(self_call_of(bin_expr->lhs), bin_expr->rhs)
+            || record(self_call_of(bin_expr->rhs), bin_expr->lhs);
+    }
+
+    void finish_function()
+    {
+        auto &recursion = current->recursion;
+        auto const& accs = current->accumulations;
+
+        // Note:
+        // Accumulations with different operators can't be merged into one accumulator.
+        // Then only simple self-recursive calls are lowered.
+        if (!accs.empty()
+                && std::all_of(std::begin(accs), std::end(accs), [&](auto const& a){ return a.second == accs[0].second; })) {
+            for (auto const& a : accs) {
+                recursion.calls.insert(a.first);
+            }
+            recursion.accumulator = accs[0].second;
+        }
+
+        if (!recursion.calls.empty()) {
+            tail_recursions.emplace(current->scope, recursion);
+        }
+    }
+
+public:
+
+    tail_recursions_type const& get_tail_recursions() const noexcept
+    {
+        return tail_recursions;
+    }
+
+    template<class Walker>
+    void visit(ast::node::function_definition const& func, Walker const& w)
+    {
+        if (func->is_template()) {
+            for (auto i : func->instantiated) {
+                ast::walk_topdown(i, *this);
+            }
+            return;
+        }
+
+        if (func->scope.expired()) {
+            return;
+        }
+
+        auto const outer = current;
+        auto const scope = func->scope.lock();
+        current = function_state{scope, tail_recursion{}, {}};
+
+        // Note:
+        // A lambda receives its captures as the receiver.  It is not lowered to a loop.
+        if (!scope->is_anonymous()) {
+            w();
+            finish_function();
+        }
+
+        current = outer;
+    }
+
+    template<class Walker>
+    void visit(ast::node::return_stmt const& ret, Walker const& w)
+    {
+        w();
+
+        if (!current || ret->ret_exprs.size() != 1u) {
+            return;
+        }
+
+        auto const& e = ret->ret_exprs[0];
+        if (auto const self_call = self_call_of(e)) {
+            current->recursion.calls.insert(*self_call);
+        } else if (auto const bin_expr = get_as<ast::node::binary_expr>(e)) {
+            record_accumulation(*bin_expr);
+        }
+    }
+
+    template<class T, class Walker>
+    void visit(T const&, Walker const& w)
+    {
+        w();
+    }
+};
+
+template<class Node>
+tail_recursions_type analyze_tail_recursions(Node &root)
+{
+    tail_recursion_analyzer analyzer;
+    ast::walk_topdown(root, analyzer);
+    return analyzer.get_tail_recursions();
+}
+
+} // namespace detail
+} // namespace semantics
+} // namespace dachs
+
+#endif    // DACHS_SEMANTICS_TAIL_RECURSION_ANALYZER_HPP_INCLUDED
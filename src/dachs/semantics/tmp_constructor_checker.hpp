@@ -32,15 +32,23 @@ struct ctor_checker {
         }
 
         auto const maybe_lit = helper::variant::get_as<ast::node::primary_literal>(args[0]);
+        auto const maybe_uint
+            = maybe_lit ?
+                helper::variant::get_as<unsigned int>((*maybe_lit)->value)
+              : boost::none;
 
-        auto const err_msg = (boost::format("1st argument of constructor of '%1%' must be constant uint") % a->to_string()).str();
-        if (!maybe_lit) {
-            return err_msg;
-        }
-
-        auto const maybe_uint = helper::variant::get_as<unsigned int>((*maybe_lit)->value);
         if (!maybe_uint) {
-            return err_msg;
+            // Note:
+            // When the length is not a constant uint, the array is allocated dynamically.
+            // Its type has no static size.
+            auto const length_type = type::type_of(args[0]);
+            if (a->size || !(length_type.is_builtin("int") || length_type.is_builtin("uint"))) {
+                return (boost::format("1st argument of constructor of '%1%' must be constant uint or length of dynamic array") % a->to_string()).str();
+            }
+            if (args.size() == 2 && type::type_of(args[1]) != type::type{a->element_type}) {
+                return (boost::format("2nd argument of constructor of '%1%' must be '%2%'") % a->to_string() % type::type{a->element_type}.to_string()).str();
+            }
+            return boost::none;
         }
 
         if (a->size && *a->size <= *maybe_uint) {
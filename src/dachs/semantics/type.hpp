@@ -539,7 +539,6 @@ struct dict_type final : public basic_type {
 
 struct range_type final : public basic_type {
     type::any_type element_type;
-    // TODO: bool is_inclusive
     bool is_inclusive;
 
     range_type() = default;
@@ -551,13 +550,13 @@ struct range_type final : public basic_type {
 
     std::string to_string() const noexcept override
     {
-        return "<range of " + element_type.to_string() + ">";
-        return "<" + ((is_inclusive ? "inclusive" : "exclusive") + ("range of " + element_type.to_string())) + ">";
+        return std::string{"<"} + (is_inclusive ? "inclusive" : "exclusive") + " range of " + element_type.to_string() + ">";
     }
 
     bool operator==(range_type const& rhs) const noexcept
     {
-        return element_type == rhs.element_type;
+        return element_type == rhs.element_type
+            && is_inclusive == rhs.is_inclusive;
     }
 
     template<class T>
@@ -63,10 +63,18 @@ auto get_command_options(ArgPtr arg)
         std::vector<std::string> libdirs;
         bool debug = false;
         bool enable_color = true; 
+        dachs::codegen::llvmir::codegen_options codegen_opts;
     } cmdopts;
 
     std::string const debug_str = "--debug";
     std::string const disable_color_str = "--disable_color";
+    std::string const bounds_check_str = "--bounds-check";
+    std::string const debug_info_str = "-g";
+    std::string const profile_generate_str = "--profile-generate";
+    std::string const profile_use_str = "--profile-use=";
+    std::string const march_str = "--march=";
+    std::string const mcpu_str = "--mcpu=";
+    std::string const mattr_str = "--mattr=";
 
     for (; *arg; ++arg) {
         if (boost::algorithm::starts_with(*arg, "--libdir=")) {
@@ -78,12 +86,26 @@ auto get_command_options(ArgPtr arg)
                     boost::is_any_of(",")
                 );
             cmdopts.libdirs.insert(std::end(cmdopts.libdirs), std::begin(libs), std::end(libs));
+        } else if (boost::algorithm::starts_with(*arg, profile_use_str)) {
+            cmdopts.codegen_opts.profile_use_file = std::string{*arg}.substr(profile_use_str.size());
+        } else if (boost::algorithm::starts_with(*arg, march_str)) {
+            cmdopts.codegen_opts.target_cpu = std::string{*arg}.substr(march_str.size());
+        } else if (boost::algorithm::starts_with(*arg, mcpu_str)) {
+            cmdopts.codegen_opts.target_cpu = std::string{*arg}.substr(mcpu_str.size());
+        } else if (boost::algorithm::starts_with(*arg, mattr_str)) {
+            cmdopts.codegen_opts.target_features = std::string{*arg}.substr(mattr_str.size());
         } else if (boost::algorithm::ends_with(*arg, ".dcs")) {
             cmdopts.source_files.emplace_back(*arg);
         } else if (*arg == debug_str) {
             cmdopts.debug = true;
         } else if (*arg == disable_color_str) {
             cmdopts.enable_color = false;
+        } else if (*arg == bounds_check_str) {
+            cmdopts.codegen_opts.bounds_check = true;
+        } else if (*arg == debug_info_str) {
+            cmdopts.codegen_opts.debug_info = true;
+        } else if (*arg == profile_generate_str) {
+            cmdopts.codegen_opts.profile_generate = true;
         } else {
             cmdopts.rest_args.emplace_back(*arg);
         }
@@ -102,13 +124,13 @@ int main(int const, char const* const argv[])
     auto const show_usage =
         [argv]()
         {
-            std::cerr << "Usage: " << argv[0] << " [--dump-ast|--dump-sym-table|--emit-llvm|--output-obj] [--debug] [--libdir={path}] {file}\n";
+            std::cerr << "Usage: " << argv[0] << " [--dump-ast|--dump-sym-table|--emit-llvm|--output-obj] [--debug] [--bounds-check] [-g] [--profile-generate|--profile-use={file}] [--march={cpu}|--mcpu={cpu}] [--mattr={features}] [--libdir={path}] {file}\n";
         };
 
     // TODO: Use Boost.ProgramOptions
 
     auto const cmdopts = dachs::cmdline::get_command_options(&argv[1]);
-    dachs::compiler compiler;
+    dachs::compiler compiler{cmdopts.codegen_opts};
 
     switch (cmdopts.rest_args.size()) {
 
@@ -7,8 +7,13 @@
 #include "dachs/semantics/scope.hpp"
 #include "dachs/semantics/semantic_analysis.hpp"
 #include "dachs/exception.hpp"
+#include "dachs/helper/variant.hpp"
 
 #include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
 
 #include <boost/test/included/unit_test.hpp>
 
@@ -212,6 +217,534 @@ BOOST_AUTO_TEST_CASE(no_lambda_capture_found)
     )");
 }
 
+BOOST_AUTO_TEST_CASE(lambda_capture_in_nested_scopes)
+{
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func foo(a, p)
+            ret p(a)
+        end
+
+        func main
+            a := 42
+            do
+                b := 3.14
+                a.foo do |i|
+                    c := i + a
+                    do
+                        println(b)
+                        println(c)
+                    end
+                    ret c
+                end.println
+            end
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(diagnostics_in_definition_order)
+{
+    // Note:
+    // 'foo' is analyzed before 'main' because callees are analyzed first.
+    // But the errors are output in the order of the source.
+    auto t = p.parse(R"(
+        func main
+            println(undefined_a)
+            println(foo(1))
+        end
+
+        func foo(x : int)
+            ret undefined_b
+        end
+    )", "test_file");
+
+    std::ostringstream output;
+    auto *const saved = std::cerr.rdbuf(output.rdbuf());
+    try {
+        dachs::semantics::analyze_semantics(t);
+        BOOST_ERROR("semantic_check_error is not thrown");
+    } catch (dachs::semantic_check_error const& e) {
+        BOOST_CHECK(std::stoul(e.what()) >= 2u);
+    }
+    std::cerr.rdbuf(saved);
+
+    auto const message = output.str();
+    auto const pos_a = message.find("undefined_a");
+    auto const pos_b = message.find("undefined_b");
+    BOOST_CHECK(pos_a != std::string::npos);
+    BOOST_CHECK(pos_b != std::string::npos);
+    BOOST_CHECK(pos_a < pos_b);
+}
+
+BOOST_AUTO_TEST_CASE(return_type_deduction_in_call_graph_order)
+{
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func main
+            println(foo(3))
+        end
+
+        func foo(a : int)
+            ret bar(a) + 1
+        end
+
+        func bar(a : int)
+            ret baz(a) * 2
+        end
+
+        func baz(a : int)
+            ret a
+        end
+    )");
+
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func main
+            println(even?(10))
+        end
+
+        func even?(n : int) : bool
+            if n == 0
+                ret true
+            end
+            ret odd?(n - 1)
+        end
+
+        func odd?(n : int) : bool
+            if n == 0
+                ret false
+            end
+            ret even?(n - 1)
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(unreachable_functions)
+{
+    // Functions unreachable from main are not analyzed
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func unused(x : int)
+            ret x + 3.14
+        end
+
+        func unused2(x)
+            ret unused(x)
+        end
+
+        func foo
+            ret 42
+        end
+
+        func main
+            println(foo())
+        end
+    )");
+
+    // All functions are analyzed without main
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func unused(x : int)
+            ret x + 3.14
+        end
+    )");
+
+    // Overloaded functions are all reachable
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func foo(x : int)
+            ret x + 3.14
+        end
+
+        func foo(x : float)
+            ret x
+        end
+
+        func main
+            println(foo(1.0))
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(compile_time_function_evaluation)
+{
+    auto t = p.parse(R"(
+        func fib(n : int) : int
+            ret n if n < 2
+            ret fib(n - 1) + fib(n - 2)
+        end
+
+        func sum(a)
+            var s := 0
+            for e in a
+                s += e
+            end
+            ret s
+        end
+
+        fib10 := fib(10)
+        total := sum([1, 2, 3, 4]) * 2
+
+        func check(i : int) : int
+            a := [1, 2, 3]
+            ret 1 if i < 3 && a[i] == 2
+            ret 0 if i >= 3 || a[i] == 0
+            ret 2
+        end
+
+        # a[5] is never evaluated because '&&' and '||' are short-circuit
+        out_of_bounds := check(5)
+        in_bounds := check(1)
+
+        # 'x' refers the memory of 'a' at run time
+        func modify_aliased(i : int) : int
+            var a := [i, i]
+            x := a
+            a[0] = 42
+            ret x[0]
+        end
+
+        aliased := modify_aliased(1)
+
+        func main
+            println(fib10 + total)
+            println(fib(20))
+            println(out_of_bounds + in_bounds)
+            println(aliased)
+        end
+    )", "test_file");
+
+    dachs::semantics::analyze_semantics(t);
+
+    auto const folded_value
+        = [&](std::size_t const idx) -> boost::optional<int>
+        {
+            auto const init = dachs::helper::variant::get_as<dachs::ast::node::initialize_stmt>(t.root->definitions[idx]);
+            BOOST_REQUIRE(init && (*init)->maybe_rhs_exprs);
+            auto const lit = dachs::helper::variant::get_as<dachs::ast::node::primary_literal>((*(*init)->maybe_rhs_exprs)[0]);
+            if (!lit) {
+                return boost::none;
+            }
+            auto const i = boost::get<int>(&(*lit)->value);
+            return i ? boost::make_optional(*i) : boost::none;
+        };
+
+    BOOST_CHECK(folded_value(2u) == 55);
+    BOOST_CHECK(folded_value(3u) == 20);
+    BOOST_CHECK(folded_value(5u) == 0);
+    BOOST_CHECK(folded_value(6u) == 1);
+    BOOST_CHECK(!folded_value(8u));
+
+    // Impure function is not evaluated
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func foo(x : int) : int
+            println(x)
+            ret x
+        end
+
+        c := foo(42)
+
+        func main
+            println(c)
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(function_effects)
+{
+    auto t = p.parse(R"(
+        func fact(n : int) : int
+            ret 1 if n <= 1
+            ret n * fact(n - 1)
+        end
+
+        func twice(n : int)
+            ret fact(n) * 2
+        end
+
+        func show(n : int)
+            println(n)
+        end
+
+        func show_twice(n : int)
+            show(twice(n))
+        end
+
+        func kind(s : string) : int
+            case s
+            when "foo", "bar"
+                ret 1
+            end
+            ret 0
+        end
+
+        func main
+            show_twice(3)
+            println(kind("foo"))
+        end
+    )", "test_file");
+
+    auto const ctx = dachs::semantics::analyze_semantics(t);
+
+    auto const effect_of
+        = [&](std::string const& name)
+        {
+            for (auto const& d : t.root->definitions) {
+                auto const f = dachs::helper::variant::get_as<dachs::ast::node::function_definition>(d);
+                if (f && (*f)->name == name) {
+                    return ctx.function_effects.at((*f)->scope.lock());
+                }
+            }
+            BOOST_FAIL("function not found: " + name);
+            return dachs::semantics::function_effect::impure;
+        };
+
+    BOOST_CHECK(effect_of("fact") == dachs::semantics::function_effect::pure);
+    BOOST_CHECK(effect_of("twice") == dachs::semantics::function_effect::pure);
+    BOOST_CHECK(effect_of("show") == dachs::semantics::function_effect::impure);
+    BOOST_CHECK(effect_of("show_twice") == dachs::semantics::function_effect::impure);
+    BOOST_CHECK(effect_of("kind") == dachs::semantics::function_effect::readonly);
+    BOOST_CHECK(effect_of("main") == dachs::semantics::function_effect::impure);
+}
+
+BOOST_AUTO_TEST_CASE(last_uses)
+{
+    auto t = p.parse(R"(
+        func main
+            var a := [1, 2, 3]
+            var b := a
+            b[0] = 42
+            println(b[0])
+
+            d := [4, 5]
+            var f := [6, 7]
+            var i := 0
+            for i < 2
+                var e := f
+                println(e[0])
+                i += 1
+            end
+            println(d[1])
+        end
+    )", "test_file");
+
+    auto const ctx = dachs::semantics::analyze_semantics(t);
+
+    std::vector<std::string> names;
+    for (auto const& ref : ctx.last_uses) {
+        names.push_back(ref->name);
+    }
+    std::sort(std::begin(names), std::end(names));
+
+    // 'f' is referred in the loop but defined outside it.  'd' is immutable.
+    BOOST_CHECK((names == std::vector<std::string>{"a", "e"}));
+}
+
+BOOST_AUTO_TEST_CASE(dynamic_array)
+{
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func main
+            var n := 10
+            var a := new [int]{n}
+            var b := new [float]{n, 3.14}
+            var c := new [uint]{n}
+            a.push(42)
+            push(b, 1.0)
+            c[0] = c.size
+        end
+    )");
+
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func main
+            var n := 10
+            var a := new [int]{n}
+            a.push(3.14)
+        end
+    )");
+
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func main
+            var n := 10
+            var a := new [int]{n, 'a'}
+        end
+    )");
+
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func main
+            var a := [1, 2, 3]
+            a.push(4)
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(range)
+{
+    CHECK_NO_THROW_SEMANTIC_ERROR(R"(
+        func main
+            var n := 10
+            for i in 0..n
+                println(i)
+            end
+            for u in 0u...10u
+                println(u)
+            end
+            r := 'a'..'z'
+            for c in r
+                println(c)
+            end
+        end
+    )");
+
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func main
+            for f in 0.0..1.0
+            end
+        end
+    )");
+
+    CHECK_THROW_SEMANTIC_ERROR(R"(
+        func main
+            for i in 0..10u
+            end
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(in_bounds_accesses)
+{
+    auto t = p.parse(R"(
+        func main
+            a := [1, 2, 3, 4]
+            var s := 0
+            for i in 0u...a.size
+                s += a[i]
+            end
+            for i in 0..3
+                s += a[i]
+            end
+            j := 2u
+            if j < a.size
+                s += a[j]
+            end
+            n := 10
+            d := new [int]{n}
+            for i in 0u...d.size
+                s += d[i]
+            end
+            var k := 3u
+            s += a[k] + d[k]
+            m := 3
+            for i in 0..m
+                s += a[i]
+            end
+            println(s)
+        end
+    )", "test_file");
+
+    auto const ctx = dachs::semantics::analyze_semantics(t);
+
+    // a[k], d[k] and a[i] in the last loop are not provably in bounds.
+    BOOST_CHECK(ctx.in_bounds_accesses.size() == 4u);
+}
+
+BOOST_AUTO_TEST_CASE(tail_recursions)
+{
+    auto t = p.parse(R"(
+        func fact(n : int) : int
+            ret 1 if n <= 1
+            ret n * fact(n - 1)
+        end
+
+        func gcd(a : int, var b : int) : int
+            ret a if b == 0
+            ret gcd(b, a % b)
+        end
+
+        func fib(n : int) : int
+            ret n if n < 2
+            ret fib(n - 1) + fib(n - 2)
+        end
+
+        func mixed(n : int) : int
+            ret 0 if n == 0
+            ret n + mixed(n - 1) if n % 2 == 0
+            ret n * mixed(n - 1)
+        end
+
+        func main
+            var i := 10
+            println(fact(i))
+            println(gcd(i, 4))
+            println(fib(i))
+            println(mixed(i))
+        end
+    )", "test_file");
+
+    auto const ctx = dachs::semantics::analyze_semantics(t);
+
+    // 'fib' is not tail recursive and 'mixed' accumulates with different operators.
+    BOOST_CHECK(ctx.tail_recursions.size() == 2u);
+    for (auto const& r : ctx.tail_recursions) {
+        auto const& name = r.first->name;
+        BOOST_CHECK(name == "fact" || name == "gcd");
+        BOOST_CHECK(r.second.calls.size() == 1u);
+        if (name == "fact") {
+            BOOST_CHECK(r.second.accumulator && *r.second.accumulator == "*");
+        } else {
+            BOOST_CHECK(!r.second.accumulator);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lambda_escapes_in_mutual_recursion)
+{
+    {
+        auto t = p.parse(R"(
+            func ping(n, p) : ()
+                p(n)
+                pong(n, p)
+            end
+
+            func pong(n, p)
+                if n > 0
+                    ping(n - 1, p)
+                end
+                ret p
+            end
+
+            func main
+                ping(3) do |i|
+                    println(i)
+                end
+            end
+        )", "test_file");
+
+        auto const ctx = dachs::semantics::analyze_semantics(t);
+
+        // 'pong' returns the do-block object passed to 'ping'.
+        BOOST_CHECK(ctx.non_escaping_lambdas.empty());
+    }
+
+    {
+        auto t = p.parse(R"(
+            func ping(n, p) : ()
+                p(n)
+                pong(n, p)
+            end
+
+            func pong(n, p) : ()
+                if n > 0
+                    ping(n - 1, p)
+                end
+            end
+
+            func main
+                ping(3) do |i|
+                    println(i)
+                end
+            end
+        )", "test_file");
+
+        auto const ctx = dachs::semantics::analyze_semantics(t);
+
+        BOOST_CHECK(ctx.non_escaping_lambdas.size() == 1u);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(invocation_with_wrong_arguments)
 {
     CHECK_THROW_SEMANTIC_ERROR(R"(
@@ -7,9 +7,16 @@
 #include "dachs/semantics/scope.hpp"
 #include "dachs/semantics/semantic_analysis.hpp"
 #include "dachs/codegen/llvmir/ir_emitter.hpp"
+#include "dachs/codegen/llvmir/profile_instrumenter.hpp"
 #include "dachs/exception.hpp"
 
 #include <string>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
 
 #include <boost/test/included/unit_test.hpp>
 
@@ -29,6 +36,26 @@ static dachs::syntax::parser p;
             BOOST_CHECK_THROW(dachs::codegen::llvmir::emit_llvm_ir(t, s, c), dachs::code_generation_error); \
         } while (false);
 
+// Note:
+// Emit LLVM IR of the code to inspect the module.  The test is aborted when the code
+// generation fails because following checks depend on the module.
+llvm::Module &emit_module(dachs::codegen::llvmir::context &c, std::string const& code)
+{
+    auto t = p.parse(code, "test_file.dcs");
+    auto s = dachs::semantics::analyze_semantics(t);
+    llvm::Module *m = nullptr;
+    BOOST_CHECK_NO_THROW(m = &dachs::codegen::llvmir::emit_llvm_ir(t, s, c));
+    BOOST_REQUIRE(m);
+    return *m;
+}
+
+llvm::Function const& get_function(llvm::Module const& m, std::string const& name)
+{
+    auto const* const f = m.getFunction(name);
+    BOOST_REQUIRE_MESSAGE(f, "Function '" << name << "' is not emitted");
+    return *f;
+}
+
 BOOST_AUTO_TEST_SUITE(codegen_llvm)
 
 BOOST_AUTO_TEST_CASE(function)
@@ -1498,6 +1525,852 @@ BOOST_AUTO_TEST_CASE(do_block_with_captures)
     )");
 }
 
+BOOST_AUTO_TEST_CASE(do_block_capturing_aggregates)
+{
+    // Lambda objects which don't escape from callee
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func times(n, p)
+            var i := 0
+            for i < n
+                p(i)
+                i += 1
+            end
+        end
+
+        func twice(p)
+            3.times do |i|
+                p(i)
+            end
+        end
+
+        func main
+            a := [1, 2, 3]
+            var t := (1, 'a', "foo")
+            s := 42
+
+            3.times do |i|
+                println(a[i] + s)
+                println(t[0])
+            end
+
+            twice() do |i|
+                println(a[i])
+                println(t[2])
+            end
+        end
+    )");
+
+    // Captures modified in non-escaping lambda objects are copied
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func times(n, p)
+            var i := 0
+            for i < n
+                p(i)
+                i += 1
+            end
+        end
+
+        func main
+            var a := [1, 2, 3]
+            var t := (1, 'a', "foo")
+
+            3.times do |i|
+                t[0] = i
+                a[i] = t[0]
+                println(a[i])
+            end
+
+            3.times do |i|
+                println(a[i] + t[0])
+            end
+        end
+    )");
+
+    // Lambda objects which escape from callee
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func id(p)
+            ret p
+        end
+
+        func main
+            a := [1, 2, 3]
+            f := id() do |i|
+                ret a[i]
+            end
+            println(f(1))
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(compile_time_function_evaluation)
+{
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func fib(n : int) : int
+            ret n if n < 2
+            ret fib(n - 1) + fib(n - 2)
+        end
+
+        func table(n)
+            ret [n, n * n, n * n * n]
+        end
+
+        fib10 := fib(10)
+
+        func main
+            println(fib10)
+            t := table(3)
+            println(t[2])
+            var x := 3
+            println(fib(x))
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(identical_code_folding)
+{
+    dachs::codegen::llvmir::context c;
+    emit_module(c, R"(
+        func poly(n)
+            ret n * n + n
+        end
+
+        func twice(n)
+            ret poly(n) + n
+        end
+
+        func main
+            var i := 10
+            var u := 10u
+            println(twice(i))
+            println(twice(u))
+            println(poly(3.0))
+        end
+    )");
+
+    // poly(int) and poly(uint) are identical.  Then twice(int) and twice(uint) are identical.
+    BOOST_CHECK(c.size_stats.merged_functions == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(do_block_inlining)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func step_to(a, b, p)
+            var i := a
+            for i <= b
+                p(i)
+                i += 1
+            end
+        end
+
+        func main
+            var sum := 0
+            1.step_to 10 do |i|
+                sum += i
+            end
+            println(sum)
+        end
+    )");
+
+    std::size_t num_inlined = 0u;
+    for (auto const& f : m) {
+        auto const name = f.getName().str();
+        if (name.find("_D7step_to") == 0u || name.find("lambda.") != std::string::npos) {
+            BOOST_CHECK(f.hasFnAttribute(llvm::Attribute::AlwaysInline));
+            ++num_inlined;
+        }
+    }
+    BOOST_CHECK(num_inlined == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(bounds_check)
+{
+    dachs::codegen::llvmir::codegen_options opts;
+    opts.bounds_check = true;
+    dachs::codegen::llvmir::context c{opts};
+    auto &m = emit_module(c, R"(
+        func main
+            a := [1, 2, 3, 4]
+            var s := 0
+            for i in 0u...a.size
+                s += a[i]
+            end
+            for i in 0..3
+                s += a[i]
+            end
+            j := 2u
+            if j < a.size
+                s += a[j]
+            end
+            n := 10
+            d := new [int]{n}
+            for i in 0u...d.size
+                s += d[i]
+            end
+            var k := 3u
+            s += a[k] + d[k]
+            m := 3
+            for i in 0..m
+                s += a[i]
+            end
+            println(s)
+        end
+    )");
+
+    // Only a[k], d[k] and a[i] in the last loop are checked.
+    auto const& trap = get_function(m, "__dachs_array_index_out_of_bounds__");
+    BOOST_CHECK(std::distance(trap.use_begin(), trap.use_end()) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(tail_recursion_to_loop)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func fact(n : int) : int
+            ret 1 if n <= 1
+            ret n * fact(n - 1)
+        end
+
+        func gcd(a : int, var b : int) : int
+            ret a if b == 0
+            ret gcd(b, a % b)
+        end
+
+        func fib(n : int) : int
+            ret n if n < 2
+            ret fib(n - 1) + fib(n - 2)
+        end
+
+        func mixed(n : int) : int
+            ret 0 if n == 0
+            ret n + mixed(n - 1) if n % 2 == 0
+            ret n * mixed(n - 1)
+        end
+
+        func main
+            var i := 10
+            println(fact(i))
+            println(gcd(i, 4))
+            println(fib(i))
+            println(mixed(i))
+        end
+    )");
+
+    auto const num_self_calls
+        = [](llvm::Function const& f)
+        {
+            std::size_t num = 0u;
+            for (auto const& b : f) {
+                for (auto const& i : b) {
+                    if (auto const* const call = llvm::dyn_cast<llvm::CallInst>(&i)) {
+                        num += call->getCalledFunction() == &f;
+                    }
+                }
+            }
+            return num;
+        };
+
+    BOOST_CHECK(num_self_calls(get_function(m, "_D4facti")) == 0u);
+    BOOST_CHECK(num_self_calls(get_function(m, "_D3gcdii")) == 0u);
+    BOOST_CHECK(num_self_calls(get_function(m, "_D3fibi")) == 2u);
+}
+
+BOOST_AUTO_TEST_CASE(mangled_function_names)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func foo(i : int)
+            println(i)
+        end
+
+        func foo(f : float)
+            println(f)
+        end
+
+        func foo(t : (int, char))
+            println(t[0])
+        end
+
+        func main
+            foo(42)
+            foo(3.14)
+            foo((1, 'a'))
+        end
+    )");
+
+    for (auto const name : {"_D3fooi", "_D3food", "_D3fooTicE"}) {
+        BOOST_CHECK(get_function(m, name).hasInternalLinkage());
+    }
+
+    BOOST_CHECK(get_function(m, "main").hasExternalLinkage());
+}
+
+BOOST_AUTO_TEST_CASE(aggregate_calling_convention)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func make_big(a)
+            ret a, a + 1, a + 2
+        end
+
+        func make_small(a)
+            ret a, a * 2
+        end
+
+        func sum(t)
+            ret t[0] + t[1] + t[2]
+        end
+
+        func main
+            t := make_big(1)
+            println(sum(t))
+            s := make_small(2)
+            println(s[1])
+        end
+    )");
+
+    // (int, int, int) is returned in the memory allocated by the caller
+    auto const& make_big = get_function(m, "_D8make_bigi");
+    BOOST_CHECK(make_big.hasStructRetAttr() && make_big.getReturnType()->isVoidTy());
+
+    // (int, int) is returned in registers
+    auto const& make_small = get_function(m, "_D10make_smalli");
+    BOOST_CHECK(!make_small.hasStructRetAttr() && make_small.getReturnType()->isStructTy());
+
+    // (int, int, int) is passed by pointer
+    auto const& sum = get_function(m, "_D3sumTiiiE");
+    BOOST_CHECK(sum.getFunctionType()->getParamType(0u)->isPointerTy());
+    BOOST_CHECK(sum.getAttributes().hasAttribute(1u, llvm::Attribute::ReadOnly));
+    BOOST_CHECK(sum.getAttributes().hasAttribute(1u, llvm::Attribute::NoCapture));
+}
+
+BOOST_AUTO_TEST_CASE(alias_metadata)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func sum(a)
+            var s := 0
+            for e in a
+                s += e
+            end
+            ret s
+        end
+
+        func main
+            a := [1, 2, 3, 4, 5, 6, 7, 8]
+            println(sum(a))
+        end
+    )");
+
+    auto const& sum = get_function(m, "_D3sumA8_i");
+    BOOST_CHECK(sum.getAttributes().hasAttribute(1u, llvm::Attribute::NoAlias));
+    BOOST_CHECK(sum.getAttributes().hasAttribute(1u, llvm::Attribute::ReadOnly));
+
+    std::size_t num_invariant_loads = 0u;
+    std::size_t num_tbaa_accesses = 0u;
+    for (auto const& b : sum) {
+        for (auto const& i : b) {
+            if (!llvm::isa<llvm::LoadInst>(&i) && !llvm::isa<llvm::StoreInst>(&i)) {
+                continue;
+            }
+            num_invariant_loads += i.getMetadata("invariant.load") != nullptr;
+            num_tbaa_accesses += i.getMetadata(llvm::LLVMContext::MD_tbaa) != nullptr;
+        }
+    }
+    BOOST_CHECK(num_invariant_loads == 0u);
+    BOOST_CHECK(num_tbaa_accesses > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(debug_info)
+{
+    dachs::codegen::llvmir::codegen_options opts;
+    opts.debug_info = true;
+    dachs::codegen::llvmir::context c{opts};
+    auto &m = emit_module(c, R"(
+        func square(x)
+            ret x * x
+        end
+
+        func main
+            var sum := 0
+            for i in 0...10
+                t := (i, square(i))
+                sum += t[1]
+            end
+            println(sum)
+        end
+    )");
+
+    BOOST_CHECK(m.getNamedMetadata("llvm.dbg.cu"));
+
+    auto const& main_func = get_function(m, "main");
+
+    std::size_t num_located = 0u;
+    std::size_t num_variables = 0u;
+    for (auto const& b : main_func) {
+        for (auto const& i : b) {
+            num_located += !i.getDebugLoc().isUnknown();
+            num_variables += llvm::isa<llvm::DbgInfoIntrinsic>(&i);
+        }
+    }
+    BOOST_CHECK(num_located > 0u);
+    BOOST_CHECK(num_variables >= 2u);
+}
+
+BOOST_AUTO_TEST_CASE(profile_instrumentation)
+{
+    dachs::codegen::llvmir::codegen_options opts;
+    opts.profile_generate = true;
+    dachs::codegen::llvmir::context c{opts};
+    auto &m = emit_module(c, R"(
+        func collatz(n)
+            ret (if n % 2 == 0 then n / 2 else 3 * n + 1)
+        end
+
+        func classify(n)
+            case n % 3
+            when 0
+                ret 0
+            when 1
+                ret 1
+            end
+            ret 2
+        end
+
+        func main
+            var n := 27
+            var steps := 0
+            for n != 1
+                n = collatz(n)
+                steps += 1
+            end
+            println(steps)
+            println(classify(steps))
+        end
+    )");
+
+    BOOST_CHECK(m.getNamedGlobal("dachs.profile.counters"));
+    BOOST_CHECK(m.getNamedGlobal("llvm.global_ctors"));
+    BOOST_CHECK(m.getFunction("__dachs_profile_register__"));
+
+    auto const& main_func = get_function(m, "main");
+
+    std::size_t num_edge_blocks = 0u;
+    for (auto const& b : main_func) {
+        num_edge_blocks += b.getName().startswith("prof.edge");
+    }
+    BOOST_CHECK(num_edge_blocks >= 2u);
+
+    // All edges of switches are counted
+    std::size_t num_switches = 0u;
+    for (auto const& f : m) {
+        for (auto const& b : f) {
+            if (auto const* const switch_inst = llvm::dyn_cast<llvm::SwitchInst>(b.getTerminator())) {
+                ++num_switches;
+                for (unsigned i = 0u; i < switch_inst->getNumSuccessors(); ++i) {
+                    BOOST_CHECK(switch_inst->getSuccessor(i)->getName().startswith("prof.edge"));
+                }
+            }
+        }
+    }
+    BOOST_CHECK(num_switches > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(profile_annotation)
+{
+    auto const code = R"(
+        func hot(n : int) : int
+            ret n * 2
+        end
+
+        func rare(n : int) : int
+            ret n * 3
+        end
+
+        func stale(n : int) : int
+            ret n * 5
+        end
+
+        func main
+            var i := 0
+            var sum := 0
+            for i < 10
+                sum += hot(i) + stale(i)
+                i += 1
+            end
+            println(rare(sum))
+        end
+    )";
+
+    auto const starts_with
+        = [](llvm::Function const& f, char const* const prefix)
+        {
+            return f.getName().startswith(prefix);
+        };
+
+    // Note:
+    // Write the profile of the program.  The checksum of stale() doesn't match.
+    //   main() is called once, hot() and stale() are called 100 times and rare() is never called.
+    //   Successor 0 of each branch is taken 30 times and successor 1 is taken 70 times.
+    std::string const profile_file = "codegen_llvm_test.profile";
+    {
+        dachs::codegen::llvmir::context c;
+        auto &m = emit_module(c, code);
+
+        dachs::codegen::llvmir::detail::profile_probe_points const points{m};
+        std::ofstream out{profile_file};
+        for (auto const& e : points.entries) {
+            auto const& f = *e.function;
+            auto const count = f.getName() == "main" ? 1u : starts_with(f, "_D4rare") ? 0u : 100u;
+            auto const checksum = starts_with(f, "_D5stale") ? e.checksum + 1u : e.checksum;
+            out << e.key << ' ' << count << '\n' << e.checksum_key << ' ' << checksum << '\n';
+        }
+        for (auto const& e : points.edges) {
+            out << e.key << ' ' << (e.successor == 0u ? 30u : e.successor == 1u ? 70u : 0u) << '\n';
+        }
+    }
+
+    dachs::codegen::llvmir::codegen_options opts;
+    opts.profile_use_file = profile_file;
+    dachs::codegen::llvmir::context c{opts};
+    auto &m = emit_module(c, code);
+    std::remove(profile_file.c_str());
+
+    auto const num_weighted_branches
+        = [](llvm::Function const& f)
+        {
+            std::size_t num = 0u;
+            for (auto const& b : f) {
+                auto const* const br = llvm::dyn_cast<llvm::BranchInst>(b.getTerminator());
+                if (!br || !br->isConditional()) {
+                    continue;
+                }
+
+                auto const* const weights = br->getMetadata(llvm::LLVMContext::MD_prof);
+                if (!weights) {
+                    continue;
+                }
+
+                BOOST_REQUIRE(weights->getNumOperands() == 3u);
+                BOOST_CHECK(llvm::cast<llvm::ConstantInt>(weights->getOperand(1u))->getZExtValue() == 31u);
+                BOOST_CHECK(llvm::cast<llvm::ConstantInt>(weights->getOperand(2u))->getZExtValue() == 71u);
+                ++num;
+            }
+            return num;
+        };
+
+    std::size_t num_checked_funcs = 0u;
+    for (auto const& f : m) {
+        if (f.isDeclaration()) {
+            continue;
+        }
+
+        if (f.getName() == "main") {
+            BOOST_CHECK(num_weighted_branches(f) > 0u);
+            ++num_checked_funcs;
+        } else if (starts_with(f, "_D3hot")) {
+            BOOST_CHECK(f.hasFnAttribute(llvm::Attribute::InlineHint));
+            BOOST_CHECK(!f.hasFnAttribute(llvm::Attribute::Cold));
+            ++num_checked_funcs;
+        } else if (starts_with(f, "_D4rare")) {
+            BOOST_CHECK(f.hasFnAttribute(llvm::Attribute::Cold));
+            BOOST_CHECK(!f.hasFnAttribute(llvm::Attribute::InlineHint));
+            ++num_checked_funcs;
+        } else if (starts_with(f, "_D5stale")) {
+            BOOST_CHECK(!f.hasFnAttribute(llvm::Attribute::InlineHint));
+            BOOST_CHECK(!f.hasFnAttribute(llvm::Attribute::Cold));
+            BOOST_CHECK(num_weighted_branches(f) == 0u);
+            ++num_checked_funcs;
+        }
+    }
+    BOOST_CHECK(num_checked_funcs == 4u);
+}
+
+BOOST_AUTO_TEST_CASE(target_cpu_and_features)
+{
+    {
+        dachs::codegen::llvmir::codegen_options opts;
+        opts.target_cpu = "haswell";
+        opts.target_features = "+avx2,-sse4a";
+        dachs::codegen::llvmir::context c{opts};
+        BOOST_CHECK(c.target_machine->getTargetCPU() == "haswell");
+        BOOST_CHECK(c.target_machine->getTargetFeatureString() == "+avx2,-sse4a");
+    }
+
+    {
+        dachs::codegen::llvmir::codegen_options opts;
+        opts.target_cpu = "native";
+        dachs::codegen::llvmir::context c{opts};
+        BOOST_CHECK(c.target_machine->getTargetCPU() == llvm::sys::getHostCPUName());
+    }
+
+    {
+        dachs::codegen::llvmir::context c;
+        BOOST_CHECK(c.target_machine->getTargetCPU().empty());
+        BOOST_CHECK(c.target_machine->getTargetFeatureString().empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(short_circuit_logical_operators)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func positive_at(a, i, n)
+            ret i < n && a[i] > 0
+        end
+
+        func main
+            a := [1, -2, 3]
+            println(positive_at(a, 3, 3))
+            b := positive_at(a, 0, 3) || positive_at(a, 1, 3) && positive_at(a, 2, 3)
+            println(b)
+        end
+    )");
+
+    auto const count_blocks
+        = [](llvm::Function const& f, char const* const prefix)
+        {
+            std::size_t num = 0u;
+            for (auto const& b : f) {
+                num += b.getName().startswith(prefix);
+            }
+            return num;
+        };
+
+    auto const& main_func = get_function(m, "main");
+    BOOST_CHECK(count_blocks(main_func, "and.rhs") == 1u);
+    BOOST_CHECK(count_blocks(main_func, "or.rhs") == 1u);
+
+    for (auto const& f : m) {
+        if (f.getName().startswith("_D11positive_at")) {
+            BOOST_CHECK(count_blocks(f, "and.rhs") == 1u);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(switch_lowering)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func main
+            i := 42
+            case i
+            when 42
+                println(i)
+            when 0, -1
+            when 0, 1, 2
+                println(i + 42)
+            end
+
+            c := 'a'
+            case c
+            when 'a', 'b'
+                println(c)
+            else
+                println('z')
+            end
+
+            s := "foo"
+            case s
+            when "foo", "bar"
+                println(s)
+            when "baz"
+                println("baz")
+            else
+                println("other")
+            end
+
+            sym := :foo
+            case sym
+            when :foo
+                println("foo")
+            when :bar
+            end
+
+            var j := i
+            case j
+            when i
+                println(j)
+            end
+        end
+    )");
+
+    auto const& main_func = get_function(m, "main");
+
+    std::vector<unsigned> num_cases;
+    for (auto const& b : main_func) {
+        if (auto const* const switch_inst = llvm::dyn_cast<llvm::SwitchInst>(b.getTerminator())) {
+            num_cases.push_back(switch_inst->getNumCases());
+        }
+    }
+
+    // Note:
+    // 'case j when i' is not a constant label
+    BOOST_CHECK_EQUAL(num_cases.size(), 4u);
+    if (num_cases.size() == 4u) {
+        BOOST_CHECK_EQUAL(num_cases[0], 5u); // 42, 0, -1, 1, 2
+        BOOST_CHECK_EQUAL(num_cases[1], 2u);
+        BOOST_CHECK(num_cases[2] >= 2u && num_cases[2] <= 3u);
+    }
+
+    // Runtime functions used by string switches only read memory
+    auto const& hash_func = get_function(m, "__dachs_string_hash__");
+    BOOST_CHECK(hash_func.hasFnAttribute(llvm::Attribute::ReadOnly));
+    BOOST_CHECK(hash_func.hasFnAttribute(llvm::Attribute::NoUnwind));
+    BOOST_CHECK(get_function(m, "strcmp").hasFnAttribute(llvm::Attribute::ReadOnly));
+}
+
+BOOST_AUTO_TEST_CASE(allocas_in_entry_block)
+{
+    dachs::codegen::llvmir::context c;
+    auto &module = emit_module(c, R"(
+        func main
+            var i := 0
+            for i < 10
+                var t := (i, i * 2)
+                a := [i, i + 1, i + 2]
+                for var e in a
+                    e += t[1]
+                    println(e)
+                end
+                i += 1
+            end
+        end
+    )");
+
+    for (auto const& f : module) {
+        for (auto const& b : f) {
+            for (auto const& i : b) {
+                if (llvm::isa<llvm::AllocaInst>(i)) {
+                    BOOST_CHECK(&b == &f.getEntryBlock());
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(move_aggregates)
+{
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func make(i)
+            ret [i, i + 1, i + 2]
+        end
+
+        func main
+            var i := 0
+            var a := [i, i * 2]
+            var b := a
+            b[0] = 42
+            var t := (i, i + 1)
+            t = (i * 3, i)
+            for var e in make(i)
+                e += 1
+                println(e)
+            end
+            println(make(i)[i])
+            println(b[0] + t[0])
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(dynamic_array)
+{
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func sum(a)
+            var s := 0u
+            for e in a
+                s += e
+            end
+            ret s
+        end
+
+        func main
+            var n := 10u
+            var a := new [uint]{n}
+            var b := new [float]{n, 3.14}
+            var i := 0u
+            for i < 100u
+                a.push(i)
+                i += 1u
+            end
+            a[0] = a.size
+            println(a[0] + a[n])
+            println(sum(a))
+            for var f in b
+                f += 1.0
+                println(f)
+            end
+            push(b, 1.0)
+            println(b.size)
+        end
+    )");
+}
+
+BOOST_AUTO_TEST_CASE(push_while_referring_elements)
+{
+    dachs::codegen::llvmir::context c;
+    auto &m = emit_module(c, R"(
+        func main
+            var a := new [int]{4u, 42}
+            for x in a
+                a.push(x)
+                println(x)
+            end
+            y := a[0]
+            a.push(1)
+            println(y)
+        end
+    )");
+
+    // Note:
+    // 'x' and 'y' must be copied out of the buffer of 'a' because push() may reallocate it.
+    auto const& entry = get_function(m, "main").getEntryBlock();
+    auto const is_alloca_named
+        = [&entry](char const* const name)
+        {
+            return std::any_of(
+                    std::begin(entry), std::end(entry),
+                    [name](auto const& i){ return llvm::isa<llvm::AllocaInst>(i) && i.getName() == name; }
+                );
+        };
+
+    BOOST_CHECK(is_alloca_named("x"));
+    BOOST_CHECK(is_alloca_named("y"));
+}
+
+BOOST_AUTO_TEST_CASE(counted_loop)
+{
+    CHECK_NO_THROW_CODEGEN_ERROR(R"(
+        func sum(r)
+            var s := 0
+            for i in r
+                s += i
+            end
+            ret s
+        end
+
+        func main
+            var n := 10
+            for i in 0..n
+                println(i)
+            end
+            for var u in 1u...10u
+                u *= 2u
+                println(u)
+            end
+            for c in 'a'..'z'
+                print(c)
+            end
+            println(sum(1..100))
+            println(sum(1...100))
+            r := 0...n
+            for _ in r
+                println("foo")
+            end
+        end
+    )");
+}
+
 BOOST_AUTO_TEST_CASE(unit_type)
 {
     CHECK_NO_THROW_CODEGEN_ERROR(R"(